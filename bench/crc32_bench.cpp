@@ -0,0 +1,17 @@
+#include "util/crc32.hpp"
+
+#include "kernel_bench.hpp"
+
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace git;
+
+int main(int argc, const char* argv[]) {
+    return kernel_bench<crc32_checksum>(argc, argv, [](const vector<char>& data) {
+        ostringstream crc;
+        crc << hex << crc32_checksum{}.update(data.data(), data.size()).value();
+        return crc.str();
+    });
+}
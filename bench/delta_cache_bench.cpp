@@ -0,0 +1,63 @@
+#include "pack/loader.hpp"
+#include "util/filesystem.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "../samples/find_pack.hpp"
+
+using namespace std;
+using namespace git;
+
+/// Reads the whole content of every object of the pack, returns the number of bytes read.
+template <typename LOADER>
+uint64_t read_all(LOADER& loader) {
+    uint64_t total = 0;
+    char buffer[64 * 1024];
+    for (const auto& item: loader.get_index()) {
+        auto& stream = loader[item].get_stream();
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0) {
+            total += stream.gcount();
+        }
+    }
+    return total;
+}
+
+/// Same as read_all with one read_content() call per object instead of a stream.
+template <typename LOADER>
+uint64_t read_all_at_once(LOADER& loader) {
+    uint64_t total = 0;
+    for (const auto& item: loader.get_index()) {
+        total += loader[item].read_content().size();
+    }
+    return total;
+}
+
+template <typename READER>
+void run(const fs::path& pack, const string& label, size_t cache_limit, READER reader) {
+    auto loader = pack_file_parser(pack);
+    loader.set_delta_base_cache_limit(cache_limit);
+
+    auto start = chrono::steady_clock::now();
+    auto total = reader(loader);
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    cout << label << ": " << loader.size() << " objects, " << total << " bytes in "
+         << elapsed.count() << " ms\n";
+}
+
+int main(int argc, const char* argv[]) {
+    fs::path pack = argc > 1 ? fs::path{argv[1]} : fs::current_path();
+    if (!find_pack(pack)) {
+        cout << "Usage: " << argv[0] << " [<git pack file or directory>]\n";
+        return -1;
+    }
+
+    auto streams = [](auto& loader) { return read_all(loader); };
+    auto at_once = [](auto& loader) { return read_all_at_once(loader); };
+
+    run(pack, "streams, delta base cache off", 0, streams);
+    run(pack, "streams, delta base cache on ", delta_base_cache::DEFAULT_LIMIT, streams);
+    run(pack, "at once, delta base cache on ", delta_base_cache::DEFAULT_LIMIT, at_once);
+}
@@ -0,0 +1,47 @@
+#ifndef KERNEL_BENCH_HPP_INCLUDED
+#define KERNEL_BENCH_HPP_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/** Times a kernel over random data, first portable then in hardware.
+ *
+ * IMPL has the use_hardware() of kernel_dispatch. run(data) processes the whole data
+ * and returns the result to print. The size in MiB is the first argument, 256 by default.
+ */
+template <typename IMPL, typename RUN>
+int kernel_bench(int argc, const char* argv[], RUN run) {
+    std::size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 256;
+
+    std::mt19937 random{42};
+    std::vector<char> data(megabytes * 1024 * 1024);
+    for (auto& byte: data) {
+        byte = static_cast<char>(random());
+    }
+
+    auto time = [&](const std::string& label) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = run(data);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto size = data.size() / (1024.0 * 1024.0);
+        std::cout << label << ": " << size << " MiB in " << elapsed.count() * 1000 << " ms, "
+                  << size / elapsed.count() << " MiB/s (" << result << ")\n";
+    };
+
+    IMPL::use_hardware(false);
+    time("portable");
+
+    if (IMPL::use_hardware(true)) {
+        time("hardware");
+    } else {
+        std::cout << "hardware: not supported by this CPU\n";
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "pack/object_header.hpp"
+#include "util/big_unsigned.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace git;
+
+namespace {
+
+/// Encodes a type and size header the way git writes it.
+void encode_header(string& out, uint8_t type, uint64_t size) {
+    uint8_t byte = static_cast<uint8_t>(type << 4 | (size & 0x0f));
+    size >>= 4;
+    while (size) {
+        out += static_cast<char>(byte | 0x80);
+        byte = size & 0x7f;
+        size >>= 7;
+    }
+    out += static_cast<char>(byte);
+}
+
+/// Encodes the base offset of an OFS_DELTA object.
+void encode_offset(string& out, uint64_t offset) {
+    uint8_t encoded[pack_header::MAX_VARINT_SIZE];
+    unsigned position = sizeof(encoded) - 1;
+    encoded[position] = offset & 0x7f;
+    while (offset >>= 7) {
+        encoded[--position] = 0x80 | (--offset & 0x7f);
+    }
+    out.append(reinterpret_cast<const char*>(encoded + position), sizeof(encoded) - position);
+}
+
+template <typename DECODER>
+void run(const string& label, size_t count, DECODER decoder) {
+    auto start = chrono::steady_clock::now();
+    auto total = decoder();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    cout << label << ": " << count << " headers in " << elapsed.count() << " ms (checksum " << total << ")\n";
+}
+
+}
+
+int main(int argc, const char* argv[]) {
+    size_t count = argc > 1 ? stoul(argv[1]) : 1000000;
+
+    // Headers of OFS_DELTA objects of random sizes and offsets, the common case in packs.
+    mt19937_64 random{42};
+    geometric_distribution<uint64_t> sizes{1.0 / 4096};
+    geometric_distribution<uint64_t> offsets{1.0 / 65536};
+    string encoded;
+    for (size_t i = 0; i < count; i++) {
+        encode_header(encoded, 6, sizes(random));
+        encode_offset(encoded, offsets(random) + 1);
+    }
+
+    run("big_unsigned_base::binread", count, [&]() {
+        istringstream input{encoded};
+        uint64_t total = 0;
+        big_unsigned_with_type header;
+        big_unsigned offset;
+        for (size_t i = 0; i < count; i++) {
+            header.binread(input);
+            offset.binread(input);
+            total += header.convert<uint64_t>() + offset.convert<uint64_t>();
+        }
+        return total;
+    });
+
+    run("pack_header raw pointer", count, [&]() {
+        auto current = reinterpret_cast<const uint8_t*>(encoded.data());
+        auto end = current + encoded.size();
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            auto header = pack_header::read_object_header(current, end);
+            current += header.length;
+            auto offset = pack_header::read_delta_offset(current, end);
+            current += offset.length;
+            total += header.size + offset.offset;
+        }
+        return total;
+    });
+}
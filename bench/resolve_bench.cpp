@@ -0,0 +1,52 @@
+#include "pack/loader.hpp"
+#include "pack/resolver.hpp"
+#include "util/filesystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../samples/find_pack.hpp"
+
+using namespace std;
+using namespace git;
+
+template <typename RUN>
+void measure(const string& label, RUN run) {
+    auto start = chrono::steady_clock::now();
+    auto total = run();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    cout << label << ": " << total << " bytes in " << elapsed.count() << " ms\n";
+}
+
+int main(int argc, const char* argv[]) {
+    fs::path pack = argc > 1 ? fs::path{argv[1]} : fs::current_path();
+    if (!find_pack(pack)) {
+        cout << "Usage: " << argv[0] << " [<git pack file or directory>]\n";
+        return -1;
+    }
+
+    measure("one object at a time", [&]() {
+        auto loader = pack_file_parser(pack);
+        uint64_t total = 0;
+        for (decltype(loader.size()) position = 0; position < loader.size(); position++) {
+            total += loader.read_content(position).size();
+        }
+        return total;
+    });
+
+    for (unsigned threads = 1; threads <= thread::hardware_concurrency(); threads *= 2) {
+        measure("resolver, " + to_string(threads) + " thread(s)", [&]() {
+            auto loader = pack_file_parser(pack);
+            pack_resolver<decltype(loader)> resolver{loader, threads};
+            atomic<uint64_t> total{0};
+            resolver.resolve([&](const object_id&, const string&, const vector<char>& content) {
+                total += content.size();
+            });
+            return total.load();
+        });
+    }
+}
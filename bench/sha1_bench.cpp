@@ -0,0 +1,14 @@
+#include "util/sha1.hpp"
+
+#include "kernel_bench.hpp"
+
+#include <vector>
+
+using namespace std;
+using namespace git;
+
+int main(int argc, const char* argv[]) {
+    return kernel_bench<sha1>(argc, argv, [](const vector<char>& data) {
+        return sha1{}.update(data.data(), data.size()).finish().to_string();
+    });
+}
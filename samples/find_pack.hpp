@@ -21,4 +21,25 @@ bool find_pack(git::fs::path& pack) {
     }
     return true;
 }
+
+inline bool has_packs(const git::fs::path& directory) {
+    if (!git::fs::is_directory(directory)) {
+        return false;
+    }
+    auto entries = git::fs::directory_iterator(directory);
+    return std::find_if(begin(entries), end(entries), [](const auto& entry) {
+        return is_pack(entry.path());
+    }) != end(entries);
+}
+
+/// Finds the directory holding the packs of a repository (or the directory itself).
+inline bool find_pack_directory(git::fs::path& directory) {
+    for (auto candidate: { directory, directory / "objects" / "pack", directory / ".git" / "objects" / "pack" }) {
+        if (has_packs(candidate)) {
+            directory = candidate;
+            return true;
+        }
+    }
+    return false;
+}
 #endif
@@ -0,0 +1,31 @@
+#include "pack/indexer.hpp"
+#include "util/filesystem.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace git;
+using namespace git::fs;
+
+int main(int argc, const char* argv[]) {
+    path directory;
+    if (argc == 1) {
+        directory = current_path();
+    } else {
+        directory = argv[1];
+    }
+
+    if (!is_directory(directory)) {
+        cout << "Usage: " << argv[0] << " [<pack directory>] < <pack>\n";
+        return -1;
+    }
+
+    try {
+        pack_indexer indexer{directory};
+        auto result = indexer.index(cin);
+        cout << result.checksum << "\n";
+    } catch (const exception& error) {
+        cerr << "Could not index pack: " << error.what() << "\n";
+        return -1;
+    }
+}
@@ -1,8 +1,11 @@
 #include "pack/loader.hpp"
+#include "pack/directory.hpp"
 #include "util/filesystem.hpp"
 
 #include <iostream>
-#include <iterator>
+
+#include <errno.h>
+#include <unistd.h>
 
 #include "find_pack.hpp"
 
@@ -10,28 +13,39 @@ using namespace std;
 using namespace git;
 using namespace git::fs;
 
-template <typename T>
-void cat_object(T& pack_loader, const std::string& name, std::string path) {
-    auto& object = pack_loader[name];
-
-    if (!object) {
+void cat_object(object_descriptor_base* object, const std::string& name, std::string path) {
+    if (!object || !*object) {
         std::cout << "Could not find object '" << name << "' at " << path << "\n";
         return;
     }
-    auto& stream = object.get_stream();
-    stream.unsetf(ios_base::skipws);
-    auto begin = istream_iterator<char>(stream);
-    auto end   = istream_iterator<char>();
-    if (begin == end) {
+    auto content = object->get_content();
+    if (content.empty()) {
         std::cout << "Empty object found.\n";
         return;
     }
-    copy(begin, end, ostream_iterator<char>(std::cout, ""));
+
+    // One write(2) for the whole object, more only if the output takes it in pieces.
+    std::cout.flush();
+    auto data = content.data();
+    auto remaining = content.size();
+    while (remaining > 0) {
+        auto written = ::write(STDOUT_FILENO, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Could not write object '" << name << "'\n";
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
 }
 
 int main(int argc, const char* argv[]) {
     if (argc < 2) {
-        cout << "Usage: " << argv[0] << " (<git pack file>) <Object ID>";
+        cout << "Usage: " << argv[0] << " (<git pack file or repository>) <Object ID>";
+        return -1;
     }
 
     string obj;
@@ -44,12 +58,17 @@ int main(int argc, const char* argv[]) {
         obj = argv[1];
     }
 
+    if (find_pack_directory(pack)) {
+        pack_directory packs{pack};
+        cat_object(packs[obj], obj, pack.string());
+        return 0;
+    }
+
     if (!find_pack(pack)) {
         return -1;
     }
 
     auto pack_loader = pack_file_parser(pack);
 
-    cat_object(pack_loader, argv[2], pack.string());
+    cat_object(&pack_loader[obj], obj, pack.string());
 }
-
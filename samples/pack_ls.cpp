@@ -1,18 +1,24 @@
 #include "pack/loader.hpp"
+#include "pack/statistics.hpp"
 #include "util/filesystem.hpp"
 
 #include "find_pack.hpp"
 
 #include <iostream>
 #include <iomanip>
+#include <string>
 
 using namespace std;
 using namespace git;
 using namespace git::fs;
 
+/// Bytes the kernel is asked to read ahead of the listing.
+constexpr uint64_t LS_READAHEAD = 4 * 1024 * 1024;
+
 template <typename T>
 void ls_pack(T& pack_loader) {
-    for (const auto& obj: pack_loader) {
+    // In pack order, as git verify-pack does, so a cold pack is read front to back.
+    for (const auto& obj: pack_loader.by_offset(LS_READAHEAD, true)) {
         cout << obj.get_name()
             << "(" << setw(6) << setfill(' ') << obj.get_type() << ") : @" <<
             hex << showbase << setw(8) << setfill('0') << internal << obj.get_pack_offset() << " " <<
@@ -20,15 +26,100 @@ void ls_pack(T& pack_loader) {
             dec << setw(6) << setfill(' ') << obj.get_pack_size() << " bytes (packed) " <<
             "data [ " << hex << setfill('0') << setw(8) << obj.get_data_offset() << " - " << setw(8) << (obj.get_data_offset() + obj.get_data_size()) << " ]" << dec << obj.get_data_size();
 
-        const auto* delta = dynamic_cast<const pack_delta_descriptor*>(&obj);
-        if (delta) {
-            cout << "\ndelta has " << delta->get_pack_depth() << " level(s) parent: " << delta->get_delta_parent().get_name() << "\n";
+        if (obj.is_delta()) {
+            cout << "\ndelta has " << obj.get_pack_depth() << " level(s) parent: " << pack_loader.get_index()[obj.get_delta_base()].get_name() << "\n";
         }
         cout << "\n";
     }
 }
 
+/// Prints the pack statistics, formatted into one buffer written at once.
+template <typename T>
+void stats_pack(T& pack_loader) {
+    auto stats = collect_pack_statistics(pack_loader);
+
+    string out;
+    auto line = [&out](const string& label, uint64_t value) {
+        out += label;
+        out += ": ";
+        out += to_string(value);
+        out += '\n';
+    };
+
+    line("objects", stats.object_count);
+    line("deltas", stats.delta_count);
+
+    auto column = [&out](string text, size_t width, bool right) {
+        auto padding = text.size() < width ? width - text.size() : 1;
+        if (right) {
+            out.append(padding, ' ');
+        }
+        out += text;
+        if (!right) {
+            out.append(padding, ' ');
+        }
+    };
+
+    out += '\n';
+    column("stored as", 18, false);
+    column("count", 12, true);
+    column("size", 14, true);
+    column("packed", 14, true);
+    out += '\n';
+    for (size_t type = 0; type < pack_statistics::TYPE_COUNT; type++) {
+        if (stats.stored_count[type] == 0) {
+            continue;
+        }
+        column(T::type_name(type), 18, false);
+        column(to_string(stats.stored_count[type]), 12, true);
+        column(to_string(stats.stored_size[type]), 14, true);
+        column(to_string(stats.packed_size[type]), 14, true);
+        out += '\n';
+    }
+
+    out += "\n";
+    for (size_t type = 0; type < pack_statistics::TYPE_COUNT; type++) {
+        if (stats.object_type_count[type] > 0) {
+            line(T::type_name(type) + " objects", stats.object_type_count[type]);
+        }
+    }
+
+    out += "\n";
+    for (size_t bucket = 0; bucket < stats.size_histogram.size(); bucket++) {
+        if (stats.size_histogram[bucket] > 0) {
+            auto below = bucket == 0 ? string("1") : to_string(uint64_t{1} << (bucket - 1) << 1);
+            line("size < " + below, stats.size_histogram[bucket]);
+        }
+    }
+
+    out += "\n";
+    for (size_t length = 0; length < stats.chain_length_histogram.size(); length++) {
+        if (stats.chain_length_histogram[length] > 0) {
+            line(length == 0 ? string("non delta") : "chain length = " + to_string(length), stats.chain_length_histogram[length]);
+        }
+    }
+
+    out += "\n";
+    for (size_t children = 1; children < stats.fan_out_histogram.size(); children++) {
+        if (stats.fan_out_histogram[children] > 0) {
+            line("bases of " + to_string(children) + " delta(s)", stats.fan_out_histogram[children]);
+        }
+    }
+    if (stats.widest_fan_out > 0) {
+        out += "widest base: " + stats.widest_base.to_string() + " (" + to_string(stats.widest_fan_out) + " deltas)\n";
+    }
+
+    cout.write(out.data(), out.size());
+}
+
 int main(int argc, const char* argv[]) {
+    // --stats prints counts and histograms from the object headers instead of every object.
+    bool stats = argc > 1 && string(argv[1]) == "--stats";
+    if (stats) {
+        argc--;
+        argv++;
+    }
+
     path pack;
     if (argc == 1) {
         pack = current_path();
@@ -42,6 +133,10 @@ int main(int argc, const char* argv[]) {
 
     auto pack_loader = pack_file_parser(pack);
 
-    ls_pack(pack_loader);
+    if (stats) {
+        stats_pack(pack_loader);
+    } else {
+        ls_pack(pack_loader);
+    }
 }
 
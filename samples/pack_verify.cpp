@@ -0,0 +1,69 @@
+#include "pack/loader.hpp"
+#include "pack/verifier.hpp"
+#include "util/filesystem.hpp"
+
+#include "find_pack.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace git;
+using namespace git::fs;
+
+int main(int argc, const char* argv[]) {
+    // --crc only checks the raw bytes of each object against the index, which is much faster.
+    bool crc_only = argc > 1 && string(argv[1]) == "--crc";
+    if (crc_only) {
+        argc--;
+        argv++;
+    }
+
+    path pack;
+    if (argc == 1) {
+        pack = current_path();
+    } else {
+        pack = argv[1];
+    }
+
+    if (!find_pack(pack)) {
+        return -1;
+    }
+
+    auto pack_loader = pack_file_parser(pack);
+
+    try {
+        if (crc_only) {
+            auto mismatches = find_crc_mismatches(pack_loader);
+            for (const auto& name: mismatches) {
+                cout << pack.string() << ": CRC mismatch " << name << "\n";
+            }
+            if (!mismatches.empty()) {
+                return 1;
+            }
+            cout << pack.string() << ": ok\n";
+            return 0;
+        }
+
+        auto result = verify_pack(pack_loader);
+        if (result.computed_checksum != result.stored_checksum) {
+            cout << pack.string() << ": pack checksum mismatch, stored " << result.stored_checksum
+                 << " computed " << result.computed_checksum << "\n";
+        }
+        if (result.index_checksum != result.stored_checksum) {
+            cout << pack.string() << ": index was built for pack " << result.index_checksum << "\n";
+        }
+        for (const auto& name: result.crc_mismatches) {
+            cout << pack.string() << ": CRC mismatch " << name << "\n";
+        }
+        for (const auto& name: result.corrupt_objects) {
+            cout << pack.string() << ": corrupt object " << name << "\n";
+        }
+        if (!result.ok()) {
+            return 1;
+        }
+    } catch (const exception& error) {
+        cout << pack.string() << ": " << error.what() << "\n";
+        return 1;
+    }
+    cout << pack.string() << ": ok\n";
+}
@@ -1,8 +1,13 @@
 #ifndef OBJECT_DESCRIPTOR_HPP_INCLUDED
 #define OBJECT_DESCRIPTOR_HPP_INCLUDED
 
+#include "object_id.hpp"
+#include "util/byte_view.hpp"
+
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 namespace git {
 
@@ -11,13 +16,23 @@ public:
     virtual ~object_descriptor_base() = default;
 
     /// Returns the name used by git.
-    virtual const std::string& get_name() const = 0;
+    virtual const object_id& get_name() const = 0;
 
     /// Checks the validity of this object.
     virtual operator bool() const = 0;
 
     /// Gets an inputs stream that reads from this object.
     virtual std::istream& get_stream() = 0;
+
+    /** Gets the whole content as contiguous bytes.
+     *
+     * By default this reads get_stream() into a buffer owned by the view.
+     */
+    virtual byte_view get_content() {
+        auto& stream = get_stream();
+        std::vector<char> content{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+        return byte_view{std::move(content)};
+    }
 };
 
 }
@@ -0,0 +1,233 @@
+#ifndef OBJECT_ID_HPP_INCLUDED
+#define OBJECT_ID_HPP_INCLUDED
+
+#include "util/git_definitions.hpp"
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace git {
+
+inline char hex_digit (unsigned val) {
+    char v = val & 0x0f;
+    if (v < 10) {
+        return '0' + v;
+    } else {
+        return 'a' + (v - 10);
+    }
+}
+
+inline bool is_hex_digit(char d) {
+    return (d >= 'a' && d <= 'f') || (d >= 'A' && d <= 'F') || (d >= '0' && d <= '9');
+}
+
+inline auto hex_value(char d) {
+    if (d >= 'a' && d <= 'f') { return d - 'a' + 10; }
+    if (d >= 'A' && d <= 'F') { return d - 'A' + 10; }
+    if (d >= '0' && d <= '9') { return d - '0'; }
+    return 0;
+}
+
+/** Binary object name.
+ *
+ * Holds the raw 20 bytes of the SHA-1 that names a git object. This is trivially copyable
+ * and the hexadecimal form is only built when requested.
+ */
+class object_id {
+public:
+    static constexpr std::size_t SIZE = OBJECT_NAME_SIZE;
+    static constexpr std::size_t HEX_SIZE = OBJECT_NAME_SIZE * 2;
+
+    using value_type = std::uint8_t;
+    using storage = std::array<value_type, SIZE>;
+    using const_iterator = storage::const_iterator;
+
+private:
+    storage bytes{};
+
+public:
+    object_id() = default;
+
+    explicit object_id(const value_type* raw) {
+        std::copy_n(raw, SIZE, bytes.begin());
+    }
+
+    /// Parses a full hexadecimal name.
+    static object_id from_hex(const std::string& hex) {
+        if (hex.size() != HEX_SIZE || !std::all_of(hex.begin(), hex.end(), is_hex_digit)) {
+            throw std::invalid_argument("invalid object name '" + hex + "'");
+        }
+
+        object_id result;
+        for (std::size_t i = 0; i < SIZE; i++) {
+            result.bytes[i] = static_cast<value_type>(hex_value(hex[2 * i]) << 4 | hex_value(hex[2 * i + 1]));
+        }
+        return result;
+    }
+
+    const value_type* data() const {
+        return bytes.data();
+    }
+
+    value_type* data() {
+        return bytes.data();
+    }
+
+    static constexpr std::size_t size() {
+        return SIZE;
+    }
+
+    const_iterator begin() const {
+        return bytes.begin();
+    }
+
+    const_iterator end() const {
+        return bytes.end();
+    }
+
+    value_type operator[](std::size_t index) const {
+        return bytes[index];
+    }
+
+    bool is_null() const {
+        return std::all_of(bytes.begin(), bytes.end(), [](auto v) { return v == 0; });
+    }
+
+    std::string to_string() const {
+        std::string result(HEX_SIZE, ' ');
+        auto it = result.begin();
+        for (auto v: bytes) {
+            *it++ = hex_digit(v >> 4);
+            *it++ = hex_digit(v & 0x0f);
+        }
+        return result;
+    }
+
+    /// Fast hash, the name is already a cryptographic digest so any word of it is good enough.
+    std::size_t hash() const {
+        std::size_t result;
+        std::memcpy(&result, bytes.data(), sizeof(result));
+        return result;
+    }
+
+    bool operator==(const object_id& other) const {
+        return std::memcmp(data(), other.data(), SIZE) == 0;
+    }
+
+    bool operator!=(const object_id& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const object_id& other) const {
+        return std::memcmp(data(), other.data(), SIZE) < 0;
+    }
+
+    bool operator>(const object_id& other) const {
+        return other < *this;
+    }
+
+    bool operator<=(const object_id& other) const {
+        return !(other < *this);
+    }
+
+    bool operator>=(const object_id& other) const {
+        return !(*this < other);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const object_id& id) {
+        char buffer[HEX_SIZE];
+        auto it = buffer;
+        for (auto v: id.bytes) {
+            *it++ = hex_digit(v >> 4);
+            *it++ = hex_digit(v & 0x0f);
+        }
+        return out.write(buffer, HEX_SIZE);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<object_id>, "object_id must be trivially copyable");
+static_assert(sizeof(object_id) == OBJECT_NAME_SIZE, "object_id must hold only the raw name");
+
+/// Number of leading hexadecimal digits two raw names have in common.
+inline unsigned common_prefix_length(const uint8_t* a, const uint8_t* b) {
+    for (unsigned i = 0; i < object_id::SIZE; i++) {
+        if (a[i] != b[i]) {
+            return 2 * i + ((a[i] >> 4) == (b[i] >> 4) ? 1 : 0);
+        }
+    }
+    return object_id::HEX_SIZE;
+}
+
+/** Abbreviated object name.
+ *
+ * The leading hexadecimal digits of an object name, kept in raw form so they can be
+ * compared against the names of an index without any conversion.
+ */
+class object_id_prefix {
+    object_id bytes;
+    unsigned length = 0;
+
+public:
+    object_id_prefix() = default;
+
+    /// Parses 1 to 40 hexadecimal digits.
+    static object_id_prefix from_hex(const std::string& hex) {
+        if (hex.empty() || hex.size() > object_id::HEX_SIZE
+                || !std::all_of(hex.begin(), hex.end(), is_hex_digit)) {
+            throw std::invalid_argument("invalid object name prefix '" + hex + "'");
+        }
+
+        object_id_prefix result;
+        result.length = static_cast<unsigned>(hex.size());
+        for (std::size_t i = 0; i < hex.size(); i++) {
+            auto shift = i % 2 == 0 ? 4 : 0;
+            result.bytes.data()[i / 2] |= static_cast<uint8_t>(hex_value(hex[i]) << shift);
+        }
+        return result;
+    }
+
+    /// Number of hexadecimal digits.
+    unsigned size() const {
+        return length;
+    }
+
+    /// Smallest name that starts with this prefix.
+    const object_id& get_name() const {
+        return bytes;
+    }
+
+    /// Compares the prefix against the same number of leading digits of a raw name.
+    int compare(const uint8_t* name) const {
+        auto full_bytes = length / 2;
+        auto cmp = std::memcmp(bytes.data(), name, full_bytes);
+        if (cmp != 0 || length % 2 == 0) {
+            return cmp;
+        }
+        return int(bytes[full_bytes] >> 4) - int(name[full_bytes] >> 4);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const object_id_prefix& prefix) {
+        return out << prefix.bytes.to_string().substr(0, prefix.length);
+    }
+};
+
+}
+
+namespace std {
+
+template <>
+struct hash<git::object_id> {
+    std::size_t operator()(const git::object_id& id) const {
+        return id.hash();
+    }
+};
+
+}
+
+#endif
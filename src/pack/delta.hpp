@@ -0,0 +1,121 @@
+#ifndef PACK_DELTA_HPP_INCLUDED
+#define PACK_DELTA_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace git {
+
+namespace delta {
+
+/// Reads one of the size varints (little endian, 7 bits per byte) of the delta header.
+inline uint64_t read_size(const uint8_t*& current, const uint8_t* end) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        if (current == end || shift >= 64) {
+            throw std::invalid_argument("corrupt delta: truncated size");
+        }
+        byte = *current++;
+        if (shift > 57 && (byte & 0x7f) >> (64 - shift) != 0) {
+            throw std::invalid_argument("corrupt delta: size over 64 bits");
+        }
+        result |= uint64_t(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return result;
+}
+
+/// Size of the object a delta produces, read from its header.
+inline uint64_t result_size(const char* delta, std::size_t delta_size) {
+    auto current = reinterpret_cast<const uint8_t*>(delta);
+    auto end = current + delta_size;
+    read_size(current, end);
+    return read_size(current, end);
+}
+
+}
+
+/** Applies a git delta to its base object, writing the result into destination.
+ *
+ * The delta starts with the base and result sizes followed by instructions that either
+ * copy a range of the base (MSB set) or insert the next 1 to 127 bytes of the delta.
+ * destination must be exactly the result size.
+ */
+inline void apply_delta(const char* base, std::size_t base_size, const char* delta_data, std::size_t delta_size,
+                        char* destination, std::size_t size) {
+    auto current = reinterpret_cast<const uint8_t*>(delta_data);
+    auto end = current + delta_size;
+
+    if (delta::read_size(current, end) != base_size) {
+        throw std::invalid_argument("corrupt delta: base size mismatch");
+    }
+    if (delta::read_size(current, end) != size) {
+        throw std::invalid_argument("delta result does not match the destination size");
+    }
+
+    auto out = destination;
+    auto out_end = out + size;
+
+    while (current < end) {
+        uint8_t instruction = *current++;
+        if (instruction & 0x80) {
+            uint64_t offset = 0;
+            uint64_t length = 0;
+            for (unsigned i = 0; i < 4; i++) {
+                if (instruction & (1 << i)) {
+                    if (current == end) {
+                        throw std::invalid_argument("corrupt delta: truncated copy");
+                    }
+                    offset |= uint64_t(*current++) << (8 * i);
+                }
+            }
+            for (unsigned i = 0; i < 3; i++) {
+                if (instruction & (0x10 << i)) {
+                    if (current == end) {
+                        throw std::invalid_argument("corrupt delta: truncated copy");
+                    }
+                    length |= uint64_t(*current++) << (8 * i);
+                }
+            }
+            if (length == 0) {
+                length = 0x10000;
+            }
+            if (offset + length > base_size || length > uint64_t(out_end - out)) {
+                throw std::invalid_argument("corrupt delta: copy out of range");
+            }
+            std::memcpy(out, base + offset, length);
+            out += length;
+        } else if (instruction != 0) {
+            if (instruction > end - current || instruction > out_end - out) {
+                throw std::invalid_argument("corrupt delta: insert out of range");
+            }
+            std::memcpy(out, current, instruction);
+            out += instruction;
+            current += instruction;
+        } else {
+            throw std::invalid_argument("corrupt delta: reserved instruction");
+        }
+    }
+
+    if (out != out_end) {
+        throw std::invalid_argument("corrupt delta: result size mismatch");
+    }
+}
+
+inline std::vector<char> apply_delta(const char* base, std::size_t base_size, const char* delta_data, std::size_t delta_size) {
+    std::vector<char> result(delta::result_size(delta_data, delta_size));
+    apply_delta(base, base_size, delta_data, delta_size, result.data(), result.size());
+    return result;
+}
+
+inline std::vector<char> apply_delta(const std::vector<char>& base, const std::vector<char>& delta_data) {
+    return apply_delta(base.data(), base.size(), delta_data.data(), delta_data.size());
+}
+
+}
+
+#endif
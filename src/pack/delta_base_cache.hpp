@@ -0,0 +1,112 @@
+#ifndef PACK_DELTA_BASE_CACHE_HPP_INCLUDED
+#define PACK_DELTA_BASE_CACHE_HPP_INCLUDED
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace git {
+
+/** Least recently used cache of delta bases, keyed by pack offset.
+ *
+ * Bounded by the total size of the cached contents, like git's core.deltaBaseCacheLimit.
+ * Contents are shared so an entry can be evicted while someone still uses it.
+ * Safe to use from many threads.
+ */
+class delta_base_cache {
+public:
+    using content_ptr = std::shared_ptr<const std::vector<char>>;
+
+    static constexpr std::size_t DEFAULT_LIMIT = 96 * 1024 * 1024;
+
+private:
+    using entry = std::pair<uint64_t, content_ptr>;
+    using list_t = std::list<entry>;
+
+    std::size_t limit;
+    std::size_t used = 0;
+    list_t entries; // Most recently used first.
+    std::unordered_map<uint64_t, list_t::iterator> by_offset;
+    // On the heap so the cache can be moved.
+    std::unique_ptr<std::mutex> lock = std::make_unique<std::mutex>();
+
+    void evict() {
+        while (used > limit && !entries.empty()) {
+            auto& oldest = entries.back();
+            used -= oldest.second->size();
+            by_offset.erase(oldest.first);
+            entries.pop_back();
+        }
+    }
+
+public:
+    explicit delta_base_cache(std::size_t limit_ = DEFAULT_LIMIT) :
+        limit{limit_}
+    {}
+
+    content_ptr get(uint64_t offset) {
+        std::lock_guard<std::mutex> guard{*lock};
+        auto found = by_offset.find(offset);
+        if (found == by_offset.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->second;
+    }
+
+    void put(uint64_t offset, content_ptr content) {
+        std::lock_guard<std::mutex> guard{*lock};
+        if (limit == 0 || content->size() > limit) {
+            return;
+        }
+
+        auto found = by_offset.find(offset);
+        if (found != by_offset.end()) {
+            used -= found->second->second->size();
+            entries.erase(found->second);
+            by_offset.erase(found);
+        }
+
+        used += content->size();
+        entries.emplace_front(offset, std::move(content));
+        by_offset.emplace(offset, entries.begin());
+        evict();
+    }
+
+    void set_limit(std::size_t limit_) {
+        std::lock_guard<std::mutex> guard{*lock};
+        limit = limit_;
+        evict();
+    }
+
+    std::size_t get_limit() const {
+        std::lock_guard<std::mutex> guard{*lock};
+        return limit;
+    }
+
+    /// Total size of the cached contents.
+    std::size_t get_used() const {
+        std::lock_guard<std::mutex> guard{*lock};
+        return used;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> guard{*lock};
+        return entries.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard{*lock};
+        entries.clear();
+        by_offset.clear();
+        used = 0;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef PACK_DELTA_FOREST_HPP_INCLUDED
+#define PACK_DELTA_FOREST_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace git {
+
+/** The deltas of a pack as a forest.
+ *
+ * Objects that are not deltas are the roots and each delta is a child of its base, so
+ * walking a tree from its root rebuilds every object in it with its base at hand. The
+ * children of each object are kept together in one array.
+ */
+template <typename INDEX>
+class delta_forest {
+    // Children of position p are children[first_child[p], first_child[p + 1]).
+    std::vector<INDEX> first_child;
+    std::vector<INDEX> children;
+    std::vector<INDEX> roots;
+
+public:
+    /// base_of() result for objects that are not deltas.
+    static constexpr INDEX ROOT = std::numeric_limits<INDEX>::max();
+    /// base_of() result for deltas whose base is not known yet, they are left out.
+    static constexpr INDEX DETACHED = ROOT - 1;
+
+    /// Children of an object, in position order.
+    struct child_range {
+        const INDEX* first;
+        const INDEX* last;
+
+        const INDEX* begin() const {
+            return first;
+        }
+
+        const INDEX* end() const {
+            return last;
+        }
+
+        bool empty() const {
+            return first == last;
+        }
+    };
+
+    delta_forest() = default;
+
+    /** Builds the forest of count objects.
+     *
+     * base_of(position) gives the position of the base of a delta, ROOT or DETACHED. It
+     * is called twice per object and should be cheap.
+     */
+    template <typename BASE_OF>
+    delta_forest(std::size_t count, BASE_OF base_of) :
+        first_child(count + 1, 0)
+    {
+        for (std::size_t position = 0; position < count; position++) {
+            auto base = base_of(position);
+            if (base == ROOT) {
+                roots.push_back(static_cast<INDEX>(position));
+            } else if (base != DETACHED) {
+                first_child[base + 1]++;
+            }
+        }
+
+        for (std::size_t position = 0; position < count; position++) {
+            first_child[position + 1] += first_child[position];
+        }
+
+        children.resize(first_child[count]);
+        auto next = first_child;
+        for (std::size_t position = 0; position < count; position++) {
+            auto base = base_of(position);
+            if (base != ROOT && base != DETACHED) {
+                children[next[base]++] = static_cast<INDEX>(position);
+            }
+        }
+    }
+
+    /// Objects that are not deltas.
+    const std::vector<INDEX>& get_roots() const {
+        return roots;
+    }
+
+    child_range children_of(INDEX position) const {
+        return child_range{children.data() + first_child[position], children.data() + first_child[position + 1]};
+    }
+};
+
+/** Shares the content of delta bases with their children within a memory budget.
+ *
+ * Contents are counted until their last holder releases them. The budget must outlive
+ * every content it shared, including those held by tasks still queued.
+ */
+class content_budget {
+    std::atomic<std::size_t> held{0};
+    std::size_t limit;
+
+public:
+    using content_ptr = std::shared_ptr<const std::vector<char>>;
+
+    explicit content_budget(std::size_t limit_) :
+        limit{limit_}
+    {}
+
+    /// The content shared, nullptr if it does not fit in the budget.
+    content_ptr share(std::vector<char>&& content) {
+        auto size = content.size();
+        if (held.fetch_add(size) + size > limit) {
+            held -= size;
+            return nullptr;
+        }
+
+        auto shared = new std::vector<char>(std::move(content));
+        return content_ptr(shared, [this, size](const std::vector<char>* released) {
+            held -= size;
+            delete released;
+        });
+    }
+
+    /// Bytes of the contents shared and still held.
+    std::size_t get_held() const {
+        return held;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef PACK_DIRECTORY_HPP_INCLUDED
+#define PACK_DIRECTORY_HPP_INCLUDED
+
+#include "pack/loader.hpp"
+#include "pack/multi_index.hpp"
+#include "util/filesystem.hpp"
+#include "object_id.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace git {
+
+/** Object store over every pack of a directory (usually objects/pack).
+ *
+ * When a multi-pack-index is present a single lookup finds the pack and offset of an
+ * object. Packs that are not covered by it, or every pack when there is none or it is
+ * corrupt, are probed one index at a time.
+ */
+class pack_directory {
+public:
+    using loader_type = decltype(pack_file_parser(std::declval<fs::path>()));
+
+    /// Where an object is stored.
+    struct location {
+        std::size_t pack;
+        uint64_t offset;
+        loader_type::index_type position; ///< Position in the index of the pack.
+
+        explicit operator bool() const {
+            return offset != 0;
+        }
+    };
+
+private:
+    fs::path directory;
+    std::vector<fs::path> pack_paths;
+    std::vector<std::unique_ptr<loader_type>> packs;
+    std::optional<multi_index_reader> multi_index;
+
+    // Packs [0, indexed_packs) are the ones covered by the multi-pack-index, in its order.
+    std::size_t indexed_packs = 0;
+
+    static std::vector<fs::path> list_packs(const fs::path& directory) {
+        std::vector<fs::path> result;
+        for (const auto& entry: fs::directory_iterator(directory)) {
+            auto path = entry.path();
+            if (path.extension() == INDEX_FILE_EXTENSION && fs::exists(git::get_pack_path(path))) {
+                result.push_back(path);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void load_multi_index(std::vector<fs::path>& available) {
+        auto path = directory / MULTI_PACK_INDEX_FILE_NAME;
+        if (!fs::exists(path)) {
+            return;
+        }
+
+        std::optional<multi_index_reader> reader;
+        try {
+            reader.emplace(path);
+        } catch (const std::invalid_argument&) {
+            return; // Corrupt, the packs are probed one by one as git does.
+        }
+
+        std::vector<fs::path> ordered;
+        for (const auto& name: reader->get_pack_names()) {
+            auto found = std::find(available.begin(), available.end(), directory / name);
+            if (found == available.end()) {
+                return; // Stale, it refers to a pack that is gone.
+            }
+            ordered.push_back(*found);
+            available.erase(found);
+        }
+
+        indexed_packs = ordered.size();
+        ordered.insert(ordered.end(), available.begin(), available.end());
+        available.swap(ordered);
+        multi_index = std::move(reader);
+    }
+
+public:
+    explicit pack_directory(const fs::path& directory_) :
+        directory{directory_}
+    {
+        pack_paths = list_packs(directory);
+        load_multi_index(pack_paths);
+
+        for (const auto& path: pack_paths) {
+            packs.push_back(std::make_unique<loader_type>(pack_file_parser(path)));
+        }
+    }
+
+    /// Number of packs.
+    std::size_t size() const {
+        return packs.size();
+    }
+
+    const loader_type& get_pack(std::size_t pack) const {
+        return *packs[pack];
+    }
+
+    const fs::path& get_pack_path(std::size_t pack) const {
+        return pack_paths[pack];
+    }
+
+    bool has_multi_index() const {
+        return multi_index.has_value();
+    }
+
+    location find(const object_id& name) const {
+        if (multi_index) {
+            auto found = (*multi_index)[name];
+            if (found) {
+                const auto& index = packs[found.pack]->get_index();
+                auto position = index.find(name);
+                if (position != index.size()) {
+                    return location{found.pack, found.offset, position};
+                }
+            }
+        }
+
+        for (auto pack = indexed_packs; pack < packs.size(); pack++) {
+            const auto& index = packs[pack]->get_index();
+            auto position = index.find(name);
+            if (position != index.size()) {
+                return location{pack, index.offset_of(position), position};
+            }
+        }
+        return location{0, 0, 0};
+    }
+
+    /// Descriptor of an object, nullptr if no pack has it.
+    pack_object_descriptor* operator[](const object_id& name) const {
+        auto found = find(name);
+        if (!found) {
+            return nullptr;
+        }
+        return &(*packs[found.pack])[found.position];
+    }
+
+    /** Reads many objects, pack by pack and each pack front to back.
+     *
+     * The names are grouped by the pack that has them, then read with
+     * pack_loader::read_all(), which calls callback(name, type, content). Missing names are
+     * skipped. Returns the number of objects read.
+     */
+    template <typename CONTAINER, typename CALLBACK>
+    std::size_t read_all(const CONTAINER& names, CALLBACK callback) const {
+        std::vector<std::vector<object_id>> by_pack(packs.size());
+        for (const auto& name: names) {
+            auto found = find(name);
+            if (found) {
+                by_pack[found.pack].push_back(name);
+            }
+        }
+
+        std::size_t count = 0;
+        for (std::size_t pack = 0; pack < packs.size(); pack++) {
+            if (!by_pack[pack].empty()) {
+                count += packs[pack]->read_all(by_pack[pack], callback);
+            }
+        }
+        return count;
+    }
+
+    pack_object_descriptor* operator[](const std::string& name) const {
+        if (name.size() != object_id::HEX_SIZE || !std::all_of(name.begin(), name.end(), is_hex_digit)) {
+            return nullptr;
+        }
+        return (*this)[object_id::from_hex(name)];
+    }
+};
+
+}
+
+#endif
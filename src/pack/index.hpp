@@ -5,28 +5,40 @@
 #include "util/indexed_iterator.hpp"
 #include "util/filesystem.hpp"
 #include "util/git_definitions.hpp"
+#include "object_id.hpp"
 #include "streams/iohelper.hpp"
 #include "streams/file_source.hpp"
+#include "pack/reverse_index.hpp"
 
 #include <vector>
 #include <sstream>
 #include <utility>
 #include <algorithm>
-#include <map>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <iostream>
 
 namespace git {
 
 constexpr auto INDEX_FILE_EXTENSION = ".idx";
 
+/// Order of the results of a batched lookup.
+enum class lookup_order {
+    input,      ///< Same order as the requested names.
+    pack_offset ///< Ascending pack offset, missing objects last.
+};
+
 class index_item {
-    std::string name;
+    object_id name;
     uint64_t pack_offset;
     uint32_t crc;
 public:
 
     explicit index_item(
-        const std::string& name_ = "",
+        const object_id& name_ = {},
         uint64_t offset_ = 0,
         uint32_t crc_ = 0
     ) :
@@ -36,7 +48,7 @@ public:
     {}
 
     explicit index_item(size_t offset_) :
-        index_item{"", offset_}
+        index_item{object_id{}, offset_}
     {}
 
     index_item operator-(size_t diff) const {
@@ -46,7 +58,7 @@ public:
         return index_item{ pack_offset - diff };
     }
 
-    const std::string& get_name() const {
+    const object_id& get_name() const {
         return name;
     }
 
@@ -68,9 +80,16 @@ public:
  *
  * This class reads a pack index and retrieves the positioning details for each object.
  *
+ * When the source is memory backed (e.g. a mapped file) the name, crc and offset
+ * tables are read in place, lookups then do not allocate and compare raw names.
+ *
+ * Packs larger than 4GiB are supported through the v2 large offset table.
+ *
+ * Lookups by offset go through a reverse index, it is either mapped from a .rev file
+ * or built on first use.
+ *
  * Helper class to implement the pack object repository.
  */
-// TODO: no support for > 4gb packages
 template <class SOURCE, typename INDEX_T = size_t>
 class index_reader_base :
     public index_iterable<index_reader_base<SOURCE, INDEX_T>, INDEX_T>
@@ -101,12 +120,23 @@ private:
 
     static const index_type CRC_SIZE = 4;
     static const index_type OFFSET_SIZE = 4;
+    static const index_type LARGE_OFFSET_SIZE = 8;
+    static const index_type TRAILER_SIZE = 2 * NAME_SIZE; // pack and index checksums.
+
+    // Offsets with this bit set are positions in the large offset table.
+    static constexpr uint32_t LARGE_OFFSET_FLAG = 0x80000000;
 
     std::array<index_type, 256> summary;
-    std::map<size_t, index_type> offset_index;
+    // Built on first use, possibly by concurrent readers: only accessed atomically.
+    mutable std::shared_ptr<const reverse_index> reverse;
 
     index_type start_crcs = 0;
     index_type start_offsets = 0;
+    index_type start_large_offsets = 0;
+    index_type large_offsets_count = 0;
+
+    // Raw index contents when the source is memory backed, nullptr otherwise.
+    const uint8_t* mapped = nullptr;
 
     void init() {
         static constexpr char V2_HEADER[] = { -1, 116, 79, 99};
@@ -141,34 +171,72 @@ private:
         }
     }
 
-    static constexpr index_type name_location(unsigned index) {
+    static constexpr index_type name_location(index_type index) {
         return NAMES_OFFSET + NAME_SIZE * index;
     }
 
-    std::string read_name(index_type index) const {
+    object_id read_name(index_type index) const {
+        if (mapped) {
+            return object_id{mapped + name_location(index)};
+        }
         return read_object_name_from(*index_source.substream(name_location(index)));
     }
 
-    auto crc_location(unsigned index) const {
+    const uint8_t* raw_name_at(index_type index, object_id& buffer) const {
+        if (mapped) {
+            return mapped + name_location(index);
+        }
+        buffer = read_name(index);
+        return buffer.data();
+    }
+
+    auto crc_location(index_type index) const {
         return start_crcs + index * CRC_SIZE;
     }
 
-    auto read_crc(unsigned index) const {
+    auto read_crc(index_type index) const {
+        if (mapped) {
+            return utils::from_netorder<uint32_t>(mapped + crc_location(index));
+        }
         return read_netorder_at<uint32_t>(index_source, crc_location(index));
     }
 
-    auto offset_location(unsigned index) const {
+    auto offset_location(index_type index) const {
         return start_offsets + index * OFFSET_SIZE;
     }
 
-    auto read_offset(unsigned index) const {
-        return read_netorder_at<uint32_t>(index_source, offset_location(index));
+    auto large_offset_location(index_type index) const {
+        return start_large_offsets + index * LARGE_OFFSET_SIZE;
     }
 
-    void load_offset_index() {
-        for(index_type i = 0; i < size(); i++) {
-            offset_index.emplace(read_offset(i), i);
+    uint64_t read_large_offset(index_type index) const {
+        if (index >= large_offsets_count) {
+            throw std::out_of_range("pack index large offset entry out of range");
         }
+        if (mapped) {
+            return utils::from_netorder<uint64_t>(mapped + large_offset_location(index));
+        }
+        return read_netorder_at<uint64_t>(index_source, large_offset_location(index));
+    }
+
+    uint64_t read_offset(index_type index) const {
+        uint32_t offset;
+        if (mapped) {
+            offset = utils::from_netorder<uint32_t>(mapped + offset_location(index));
+        } else {
+            offset = read_netorder_at<uint32_t>(index_source, offset_location(index));
+        }
+
+        if (offset & LARGE_OFFSET_FLAG) {
+            return read_large_offset(offset & ~LARGE_OFFSET_FLAG);
+        }
+        return offset;
+    }
+
+    index_type find_pack_position(uint64_t offset) const {
+        return get_reverse_index().find(offset, [this](auto index) {
+            return read_offset(index);
+        });
     }
 
 public:
@@ -177,11 +245,56 @@ public:
         ITERABLE(*this),
         index_source(std::forward<ARGS>(args)...)
     {
+        mapped = reinterpret_cast<const uint8_t*>(index_source.data());
+        auto index_size = index_source.size();
+        if (index_size && *index_size < NAMES_OFFSET + TRAILER_SIZE) {
+            throw std::invalid_argument("pack index is too small for its fanout table");
+        }
+
         init();
         load_summary();
         start_crcs = name_location(size());
         start_offsets = crc_location(size());
-        load_offset_index();
+        start_large_offsets = offset_location(size());
+
+        // Whatever follows the offsets and precedes the trailer is the large offset table.
+        if (index_size) {
+            if (*index_size < start_large_offsets + TRAILER_SIZE) {
+                throw std::invalid_argument("pack index is too small for its object count");
+            }
+            large_offsets_count = (*index_size - start_large_offsets - TRAILER_SIZE) / LARGE_OFFSET_SIZE;
+        }
+    }
+
+    /// Uses a reverse index loaded elsewhere (e.g. a .rev file) instead of computing it.
+    void use_reverse_index(reverse_index index) {
+        if (index.size() != size()) {
+            throw std::invalid_argument("reverse index does not match the pack index");
+        }
+        std::atomic_store(&reverse, std::make_shared<const reverse_index>(std::move(index)));
+    }
+
+    const reverse_index& get_reverse_index() const {
+        auto current = std::atomic_load(&reverse);
+        if (!current) {
+            auto built = std::make_shared<const reverse_index>(reverse_index::build(size(), [this](auto index) {
+                return read_offset(index);
+            }));
+            // Readers racing here keep whichever index was stored first.
+            if (std::atomic_compare_exchange_strong(&reverse, &current, built)) {
+                current = built;
+            }
+        }
+        return *current;
+    }
+
+    /// Checksum of the pack this index describes.
+    object_id get_pack_checksum() const {
+        auto location = index_source.size().value() - TRAILER_SIZE;
+        if (mapped) {
+            return object_id{mapped + location};
+        }
+        return read_object_name_from(*index_source.substream(location));
     }
 
     auto operator[](index_type index) const {
@@ -197,59 +310,227 @@ public:
     }
 
     auto operator[](const value_type& item) const {
-        auto found = offset_index.find(item.get_pack_offset());
-        if (found == offset_index.end()) {
+        auto position = find_pack_position(item.get_pack_offset());
+        if (position == size()) {
             return value_type{};
         }
-        return (*this)[found->second];
+        return (*this)[get_reverse_index()[position]];
     }
 
-    auto operator[](std::string name) const {
-        if (name == "") return value_type{};
+    /// Pack offset of the object at an index position.
+    uint64_t offset_of(index_type index) const {
+        return read_offset(index);
+    }
 
-        int first, second;
+    /// Finds the position of the object starting at a pack offset, returns size() if there is none.
+    index_type find_offset(uint64_t offset) const {
+        auto position = find_pack_position(offset);
+        if (position == size()) {
+            return size();
+        }
+        return get_reverse_index()[position];
+    }
 
-        if (name.size() >= 2) {
-            second = hex_value(name[0]) * 16 + hex_value(name[1]);
-            first = second - 1;
-        } else {
-            first = hex_value(name[0]) * 16 ;
-            second = first + 15;
-        }
-
-        auto start = first > 0 ? summary[first] : 0;
-        auto finish = start + summary[second] - start;
-
-        auto value = value_type{name, 0};
-        auto range = std::equal_range(
-                begin() + start,
-                begin() + finish,
-                value,
-                [](const auto &a, const auto& b) {
-                    auto& name_a = a.get_name();
-                    auto& name_b = b.get_name();
-
-                    auto size = std::min(name_a.size(), name_b.size());
-                    if (size == 0) return false;
-                    return lexicographical_compare(
-                            std::begin(name_a), std::begin(name_a) + size,
-                            std::begin(name_b), std::begin(name_b) + size);
+    /// Finds the position of an object by its name, returns size() if it is not present.
+    index_type find(const object_id& name) const {
+        index_type first = name[0] > 0 ? summary[name[0] - 1] : 0;
+        index_type last = summary[name[0]];
+        object_id buffer;
+
+        while (first < last) {
+            auto middle = first + (last - first) / 2;
+            auto cmp = std::memcmp(raw_name_at(middle, buffer), name.data(), NAME_SIZE);
+            if (cmp == 0) {
+                return middle;
+            } else if (cmp < 0) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return size();
+    }
+
+    auto operator[](const object_id& name) const {
+        return (*this)[find(name)];
+    }
+
+    /// Result of a batched lookup.
+    struct lookup_result {
+        size_t input;        ///< Position of the name in the request.
+        index_type position; ///< Index position, size() if the object is not present.
+        uint64_t offset;     ///< Pack offset, 0 if the object is not present.
+
+        explicit operator bool() const {
+            return offset != 0;
+        }
+    };
+
+    /** Finds many objects at once.
+     *
+     * The names are sorted and resolved in a single sweep over the index, each search
+     * gallops forward from the previous match instead of restarting from the fanout bucket.
+     */
+    template <typename ID_IT>
+    std::vector<lookup_result> find_all(ID_IT first, ID_IT last, lookup_order order = lookup_order::input) const {
+        std::vector<lookup_result> results(std::distance(first, last));
+        for (size_t i = 0; i < results.size(); i++) {
+            results[i] = lookup_result{i, size(), 0};
+        }
+
+        std::sort(results.begin(), results.end(), [first](const auto& a, const auto& b) {
+            return first[a.input] < first[b.input];
+        });
+
+        object_id buffer;
+        index_type cursor = 0;
+        for (auto& result: results) {
+            const object_id& name = first[result.input];
+            auto before = [&](index_type position) {
+                return std::memcmp(raw_name_at(position, buffer), name.data(), NAME_SIZE) < 0;
+            };
+
+            index_type bucket_end = summary[name[0]];
+            index_type low = std::max(cursor, name[0] > 0 ? summary[name[0] - 1] : index_type{0});
+            index_type high = low;
+            for (index_type step = 1; high < bucket_end && before(high); step *= 2) {
+                low = high + 1;
+                high = std::min(bucket_end, high + step);
+            }
+
+            auto end = std::min(high + 1, bucket_end);
+            while (low < end) {
+                auto middle = low + (end - low) / 2;
+                if (before(middle)) {
+                    low = middle + 1;
+                } else {
+                    end = middle;
                 }
-        );
+            }
 
-         if (range.first != end() && std::distance(range.first, range.second) == 1) {
-            return *range.first;
+            cursor = low;
+            if (low < bucket_end && std::memcmp(raw_name_at(low, buffer), name.data(), NAME_SIZE) == 0) {
+                result.position = low;
+                result.offset = read_offset(low);
+            }
+        }
+
+        if (order == lookup_order::pack_offset) {
+            std::sort(results.begin(), results.end(), [](const auto& a, const auto& b) {
+                return (a.offset - 1) < (b.offset - 1); // Missing (0) wraps to the end.
+            });
         } else {
-            return index_item{};
+            std::vector<lookup_result> ordered(results.size());
+            for (const auto& result: results) {
+                ordered[result.input] = result;
+            }
+            results.swap(ordered);
         }
+        return results;
+    }
+
+    template <typename CONTAINER>
+    auto find_all(const CONTAINER& names, lookup_order order = lookup_order::input) const {
+        return find_all(std::begin(names), std::end(names), order);
+    }
+
+    /// Positions [first, last) of the objects whose name match a prefix.
+    struct prefix_range {
+        index_type first;
+        index_type last;
+
+        index_type size() const {
+            return last - first;
+        }
+
+        bool empty() const {
+            return first == last;
+        }
+
+        bool is_ambiguous() const {
+            return size() > 1;
+        }
+    };
+
+    /** Finds all objects whose name start with prefix.
+     *
+     * The fanout table bounds the search and the raw names are binary searched, nothing is
+     * allocated. An ambiguous prefix results in a range with every candidate.
+     */
+    prefix_range find_prefix(const object_id_prefix& prefix) const {
+        uint8_t lead = prefix.get_name()[0];
+        uint8_t last_lead = prefix.size() == 1 ? lead | 0x0f : lead;
+
+        index_type first = lead > 0 ? summary[lead - 1] : 0;
+        index_type last = summary[last_lead];
+        object_id buffer;
+
+        auto lower = first;
+        for (auto count = last - first; count > 0;) {
+            auto step = count / 2;
+            if (prefix.compare(raw_name_at(lower + step, buffer)) > 0) {
+                lower += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+
+        auto upper = lower;
+        for (auto count = last - lower; count > 0;) {
+            auto step = count / 2;
+            if (prefix.compare(raw_name_at(upper + step, buffer)) >= 0) {
+                upper += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+
+        return prefix_range{lower, upper};
+    }
+
+    /** Shortest abbreviation length that identifies every object of this index.
+     *
+     * Names are sorted so only neighbours need to be compared, this is a single pass.
+     */
+    unsigned min_unique_abbreviation(unsigned minimum = 4) const {
+        unsigned result = minimum;
+        object_id previous_buffer;
+        object_id current_buffer;
+
+        for (index_type i = 1; i < size(); i++) {
+            auto previous = raw_name_at(i - 1, previous_buffer);
+            auto current = raw_name_at(i, current_buffer);
+            result = std::max(result, common_prefix_length(previous, current) + 1);
+        }
+        return std::min<unsigned>(result, object_id::HEX_SIZE);
+    }
+
+    auto operator[](const object_id_prefix& prefix) const {
+        auto range = find_prefix(prefix);
+        if (range.size() != 1) {
+            return value_type{};
+        }
+        return (*this)[range.first];
+    }
+
+    /// Finds an object by its full or abbreviated name, ambiguous abbreviations are not found.
+    auto operator[](const std::string& name) const {
+        if (name.empty() || name.size() > object_id::HEX_SIZE
+                || !std::all_of(name.begin(), name.end(), is_hex_digit)) {
+            return value_type{};
+        }
+        if (name.size() == object_id::HEX_SIZE) {
+            return (*this)[object_id::from_hex(name)];
+        }
+        return (*this)[object_id_prefix::from_hex(name)];
     }
 
     auto next(const value_type& item) const {
-        auto offset = item.get_pack_offset();
-        auto it = offset_index.find(offset);
-        if (it != offset_index.end()) {
-            std::advance(it, 1);
-            return (*this)[it->second];
+        auto position = find_pack_position(item.get_pack_offset());
+        if (position + 1 < size()) {
+            return (*this)[get_reverse_index()[position + 1]];
         } else {
             return value_type{};
         }
@@ -283,7 +564,17 @@ static fs::path get_index_path(PATH file) {
 
 template <class PATH>
 auto index_file_parser(PATH filename) {
-    return index_reader_base<file_source>(get_index_path(filename).string());
+    auto index = index_reader_base<file_source>(get_index_path(filename).string());
+
+    auto reverse_path = get_reverse_index_path(filename);
+    if (fs::exists(reverse_path)) {
+        // Like git, a .rev that does not fit the index is ignored and the order computed.
+        try {
+            index.use_reverse_index(reverse_index::load(reverse_path, index.size(), index.get_pack_checksum()));
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    return index;
 }
 
 }
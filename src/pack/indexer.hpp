@@ -0,0 +1,586 @@
+#ifndef PACK_INDEXER_HPP_INCLUDED
+#define PACK_INDEXER_HPP_INCLUDED
+
+#include "pack/delta.hpp"
+#include "pack/delta_forest.hpp"
+#include "pack/object_header.hpp"
+#include "streams/file_source.hpp"
+#include "streams/inflate_buffer.hpp"
+#include "util/buffer.hpp"
+#include "util/crc32.hpp"
+#include "util/filesystem.hpp"
+#include "util/sha1.hpp"
+#include "util/sha1dc.hpp"
+#include "util/work_stealing.hpp"
+#include "object_id.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <zlib.h>
+
+namespace git {
+
+/// Name, pack offset and CRC32 of one object, as a v2 pack index keeps them.
+struct pack_index_entry {
+    object_id name;
+    uint64_t offset = 0;
+    uint32_t crc = 0;
+};
+
+/** Writes a v2 pack index.
+ *
+ * Entries can come in any order, they are sorted by name. Offsets that do not fit in 31
+ * bits go to the large offset table. The file ends with the pack checksum and the SHA-1
+ * of everything before it.
+ */
+inline void write_pack_index(const fs::path& path, std::vector<pack_index_entry> entries, const object_id& pack_checksum) {
+    static constexpr uint32_t LARGE_OFFSET_FLAG = 0x80000000;
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.name < b.name;
+    });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    sha1 checksum;
+    auto put = [&](const void* data, std::size_t size) {
+        out.write(static_cast<const char*>(data), size);
+        checksum.update(data, size);
+    };
+    auto put_netorder = [&](auto value) {
+        uint8_t bytes[sizeof(value)];
+        for (int i = sizeof(value) - 1; i >= 0; i--) {
+            bytes[i] = static_cast<uint8_t>(value & 0xff);
+            value >>= 8;
+        }
+        put(bytes, sizeof(bytes));
+    };
+
+    put("\xfftOc", 4);
+    put_netorder(uint32_t{2});
+
+    uint32_t count = 0;
+    for (unsigned bucket = 0; bucket < 256; bucket++) {
+        while (count < entries.size() && entries[count].name[0] == bucket) {
+            count++;
+        }
+        put_netorder(count);
+    }
+
+    for (const auto& entry: entries) {
+        put(entry.name.data(), entry.name.size());
+    }
+    for (const auto& entry: entries) {
+        put_netorder(entry.crc);
+    }
+
+    std::vector<uint64_t> large_offsets;
+    for (const auto& entry: entries) {
+        if (entry.offset < LARGE_OFFSET_FLAG) {
+            put_netorder(static_cast<uint32_t>(entry.offset));
+        } else {
+            put_netorder(static_cast<uint32_t>(LARGE_OFFSET_FLAG | large_offsets.size()));
+            large_offsets.push_back(entry.offset);
+        }
+    }
+    for (auto offset: large_offsets) {
+        put_netorder(offset);
+    }
+
+    put(pack_checksum.data(), pack_checksum.size());
+    auto digest = checksum.finish();
+    out.write(reinterpret_cast<const char*>(digest.data()), digest.size());
+    if (!out) {
+        throw std::runtime_error("could not write pack index " + path.string());
+    }
+}
+
+/** Builds the index of a pack received as a stream, like git index-pack --stdin does.
+ *
+ * The stream is read in one pass: each object is inflated as it arrives, to find where it
+ * ends and to hash it when it is not a delta, while the raw bytes go through the pack
+ * checksum and the object CRC32 and are spilled to a temporary file. Only a few words per
+ * object stay in memory.
+ *
+ * Deltas are then resolved from the spilled pack with a work stealing scheduler, walking
+ * each delta tree from its base. Bases kept for their children are limited by a memory
+ * budget, over it they are rebuilt from the pack. Thin packs, with deltas against objects
+ * that are not in the pack, are rejected. Objects are named with collision detection, an
+ * object crafted with a SHA-1 collision attack throws sha1_collision_error.
+ *
+ * The pack and its index are renamed to pack-<checksum>.pack and .idx once complete.
+ */
+class pack_indexer {
+public:
+    static constexpr std::size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    /// What index() produced.
+    struct result {
+        object_id checksum;
+        fs::path pack_path;
+        fs::path index_path;
+        std::size_t object_count = 0;
+    };
+
+private:
+    static constexpr uint32_t NO_BASE = 0xffffffff;
+    static constexpr std::size_t HEADER_SIZE = 12;
+
+    /// Everything kept per object between reading the stream and writing the index.
+    struct entry {
+        uint64_t offset = 0;
+        uint64_t size = 0;        ///< Inflated size, for deltas the size of the delta itself.
+        object_id name;           ///< Known once the object was hashed.
+        uint32_t crc = 0;
+        uint32_t base = NO_BASE;  ///< Entry of the delta base, set for REF_DELTA once it is found.
+        uint8_t type = 0;         ///< Type code as stored in the pack.
+        uint8_t object_type = 0;  ///< Type of the object, for deltas known once resolved.
+        uint8_t header_size = 0;  ///< Bytes before the compressed data, delta base included.
+    };
+
+    /// REF_DELTA waiting for the object with base_name.
+    struct ref_delta {
+        object_id base_name;
+        uint32_t entry;
+    };
+
+    using content_ptr = content_budget::content_ptr;
+
+    struct task {
+        uint32_t entry;
+        content_ptr base;    ///< Content of the base of a delta, nullptr when over budget.
+    };
+
+    /** Input stream window that hands every consumed byte to the pack.
+     *
+     * Consumed bytes stay in the buffer until it is refilled, then they are hashed and
+     * written to the spill file in one go.
+     */
+    class pack_stream {
+        std::istream& input;
+        int spill;
+        std::vector<uint8_t> buffer;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::size_t flushed = 0;
+        uint64_t position = 0;
+        crc32_checksum crc;
+        sha1 checksum;
+
+        void flush(bool hashed) {
+            auto data = buffer.data() + flushed;
+            auto size = begin - flushed;
+            if (hashed) {
+                checksum.update(data, size);
+            }
+            while (size > 0) {
+                auto written = ::write(spill, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::system_category(), "writing received pack");
+                }
+                data += written;
+                size -= written;
+            }
+            flushed = begin;
+        }
+
+    public:
+        pack_stream(std::istream& input_, int spill_, std::size_t buffer_size) :
+            input{input_},
+            spill{spill_},
+            buffer(buffer_size)
+        {}
+
+        /// Makes at least count bytes available if the input has them, returns how many are.
+        /// The buffer grows when it can not hold count bytes.
+        std::size_t fill(std::size_t count) {
+            if (end - begin >= count) {
+                return end - begin;
+            }
+
+            flush(true);
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = flushed = 0;
+            if (count > buffer.size()) {
+                buffer.resize(std::max(count, 2 * buffer.size()));
+            }
+
+            while (end < count && input) {
+                input.read(reinterpret_cast<char*>(buffer.data() + end), buffer.size() - end);
+                end += input.gcount();
+            }
+            return end - begin;
+        }
+
+        /// Like fill() but a short input is a truncated pack.
+        void require(std::size_t count) {
+            if (fill(count) < count) {
+                throw std::runtime_error("truncated pack");
+            }
+        }
+
+        const uint8_t* data() const {
+            return buffer.data() + begin;
+        }
+
+        std::size_t available() const {
+            return end - begin;
+        }
+
+        void consume(std::size_t count) {
+            crc.update(data(), count);
+            begin += count;
+            position += count;
+        }
+
+        /// Pack offset of the next byte.
+        uint64_t offset() const {
+            return position;
+        }
+
+        void start_object() {
+            crc = crc32_checksum{};
+        }
+
+        uint32_t object_crc() const {
+            return crc.value();
+        }
+
+        /// Checksum of everything consumed so far, checked against the trailer that follows.
+        object_id finish() {
+            flush(true);
+            auto expected = checksum.finish();
+
+            require(OBJECT_NAME_SIZE);
+            object_id trailer{data()};
+            consume(OBJECT_NAME_SIZE);
+            flush(false);
+            if (trailer != expected) {
+                throw std::runtime_error("pack checksum mismatch");
+            }
+            return expected;
+        }
+    };
+
+    fs::path directory;
+    std::size_t thread_count;
+    std::size_t memory_limit = DEFAULT_MEMORY_LIMIT;
+    std::size_t buffer_size = BUFFER_SIZE;
+
+    static uint32_t find_entry(const std::vector<entry>& entries, uint64_t offset) {
+        auto found = std::lower_bound(entries.begin(), entries.end(), offset, [](const entry& e, uint64_t value) {
+            return e.offset < value;
+        });
+        if (found == entries.end() || found->offset != offset) {
+            throw std::invalid_argument("corrupt pack: delta base is not an object");
+        }
+        return static_cast<uint32_t>(found - entries.begin());
+    }
+
+    /// Inflates the object at the stream position, hashing its content unless it is a delta.
+    static void read_object(pack_stream& stream, entry& object, std::vector<uint8_t>& scratch) {
+        auto is_delta = pack_header::is_delta(object.type);
+        sha1dc hash;
+        if (!is_delta) {
+            hash_object_header(hash, pack_header::type_name(object.type), object.size);
+        }
+
+        auto zlib = inflater_pool::acquire();
+        uint64_t produced = 0;
+        int status = Z_OK;
+        while (status != Z_STREAM_END) {
+            auto available = stream.fill(1);
+            if (available == 0) {
+                throw std::runtime_error("truncated pack");
+            }
+
+            zlib->next_in = const_cast<Bytef*>(stream.data());
+            zlib->avail_in = static_cast<uInt>(available);
+            zlib->next_out = scratch.data();
+            zlib->avail_out = static_cast<uInt>(scratch.size());
+            status = inflate(zlib.get(), Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("inflate failed: ") + (zlib->msg ? zlib->msg : "corrupt data"));
+            }
+
+            auto consumed = available - zlib->avail_in;
+            auto output = scratch.size() - zlib->avail_out;
+            stream.consume(consumed);
+            produced += output;
+            if (produced > object.size) {
+                throw std::runtime_error("inflate failed: object larger than expected");
+            }
+            if (!is_delta) {
+                hash.update(scratch.data(), output);
+            }
+
+            // zlib wants more than what is buffered, refilling has to bring new bytes.
+            if (status != Z_STREAM_END && consumed == 0 && output == 0 && stream.fill(available + 1) <= available) {
+                throw std::runtime_error("truncated pack");
+            }
+        }
+
+        if (produced != object.size) {
+            throw std::runtime_error("inflate failed: object smaller than expected");
+        }
+        if (!is_delta) {
+            object.name = finish_object_name(hash);
+            object.object_type = object.type;
+        }
+    }
+
+    /// Reads the whole stream into spill, returns its checksum.
+    object_id read_pack(std::istream& input, int spill, std::vector<entry>& entries, std::vector<ref_delta>& ref_deltas) const {
+        pack_stream stream{input, spill, buffer_size};
+        std::vector<uint8_t> scratch(buffer_size);
+
+        stream.require(HEADER_SIZE);
+        auto header = stream.data();
+        if (std::memcmp(header, "PACK", 4) != 0) {
+            throw std::invalid_argument("not a pack: bad signature");
+        }
+        auto version = utils::from_netorder<uint32_t>(header + 4);
+        if (version != 2 && version != 3) {
+            throw std::invalid_argument("unsupported pack version " + std::to_string(version));
+        }
+        auto count = utils::from_netorder<uint32_t>(header + 8);
+        stream.consume(HEADER_SIZE);
+
+        // The count comes from the stream, do not trust it with the whole allocation.
+        entries.reserve(std::min<uint32_t>(count, 1 << 20));
+        for (uint32_t i = 0; i < count; i++) {
+            stream.start_object();
+            entry object;
+            object.offset = stream.offset();
+
+            auto available = stream.fill(pack_header::MAX_VARINT_SIZE);
+            auto object_header = pack_header::read_object_header(stream.data(), stream.data() + available);
+            stream.consume(object_header.length);
+            object.type = object_header.type;
+            object.size = object_header.size;
+            object.header_size = static_cast<uint8_t>(object_header.length);
+
+            if (object.type == pack_header::DELTA_WITH_OFFSET) {
+                available = stream.fill(pack_header::MAX_VARINT_SIZE);
+                auto delta = pack_header::read_delta_offset(stream.data(), stream.data() + available);
+                stream.consume(delta.length);
+                object.header_size += delta.length;
+                if (delta.offset == 0 || delta.offset > object.offset) {
+                    throw std::invalid_argument("corrupt pack: delta base offset out of range");
+                }
+                object.base = find_entry(entries, object.offset - delta.offset);
+            } else if (object.type == pack_header::DELTA_WITH_OBJID) {
+                stream.require(OBJECT_NAME_SIZE);
+                ref_deltas.push_back(ref_delta{object_id{stream.data()}, i});
+                stream.consume(OBJECT_NAME_SIZE);
+                object.header_size += OBJECT_NAME_SIZE;
+            } else if (object.type < pack_header::COMMIT || object.type > pack_header::TAG) {
+                throw std::invalid_argument("corrupt pack: invalid object type " + std::to_string(object.type));
+            }
+
+            read_object(stream, object, scratch);
+            object.crc = stream.object_crc();
+            entries.push_back(object);
+        }
+
+        return stream.finish();
+    }
+
+    /// Rebuilds every delta from the spilled pack, returns how many were resolved.
+    std::size_t resolve_deltas(const fs::path& pack_path, std::vector<entry>& entries, std::vector<ref_delta>& ref_deltas) const {
+        std::sort(ref_deltas.begin(), ref_deltas.end(), [](const ref_delta& a, const ref_delta& b) {
+            return a.base_name < b.base_name;
+        });
+
+        // REF_DELTA children are only known once their base is hashed, they are looked up by name.
+        auto count = entries.size();
+        delta_forest<uint32_t> forest{count, [&entries](std::size_t e) {
+            switch (entries[e].type) {
+            case pack_header::DELTA_WITH_OFFSET:
+                return entries[e].base;
+            case pack_header::DELTA_WITH_OBJID:
+                return delta_forest<uint32_t>::DETACHED;
+            default:
+                return delta_forest<uint32_t>::ROOT;
+            }
+        }};
+        const auto& roots = forest.get_roots();
+        if (roots.size() == count) {
+            return 0;
+        }
+
+        file_mapper<char> pack{pack_path};
+        auto objects_end = pack.size() - OBJECT_NAME_SIZE;
+        auto read_stored = [&](uint32_t e) {
+            const auto& object = entries[e];
+            auto data = object.offset + object.header_size;
+            auto data_end = e + 1 < count ? entries[e + 1].offset : objects_end;
+            std::vector<char> content(object.size);
+            inflate_into(pack.get() + data, data_end - data, content.data(), content.size());
+            return content;
+        };
+        // Bases over budget are rebuilt walking up to the object at the end of their chain.
+        auto rebuild = [&](uint32_t e) {
+            std::vector<uint32_t> chain;
+            while (entries[e].base != NO_BASE) {
+                chain.push_back(e);
+                e = entries[e].base;
+            }
+            auto content = read_stored(e);
+            for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+                content = apply_delta(content, read_stored(*link));
+            }
+            return content;
+        };
+
+        content_budget budget{memory_limit};
+        std::atomic<std::size_t> resolved{0};
+        // Equal names, as when a pack has the same object twice, must not claim a REF_DELTA twice.
+        std::vector<std::atomic<bool>> claimed(ref_deltas.size());
+
+        work_stealing_scheduler<task> scheduler{thread_count};
+        for (std::size_t i = 0; i < roots.size(); i++) {
+            scheduler.push(i, task{roots[i], nullptr});
+        }
+
+        scheduler.run([&](std::size_t worker, task& current) {
+            auto e = current.entry;
+            auto& object = entries[e];
+            auto is_base = object.base == NO_BASE;
+
+            std::vector<char> content;
+            if (!is_base) {
+                auto base = current.base ? current.base : std::make_shared<const std::vector<char>>(rebuild(object.base));
+                content = apply_delta(*base, read_stored(e));
+                object.object_type = entries[object.base].object_type;
+                object.name = hash_object(pack_header::type_name(object.object_type), content.data(), content.size());
+                ++resolved;
+            }
+
+            auto ref_children = std::equal_range(ref_deltas.begin(), ref_deltas.end(), ref_delta{object.name, 0},
+                [](const ref_delta& a, const ref_delta& b) {
+                    return a.base_name < b.base_name;
+                });
+            auto children = forest.children_of(e);
+            if (children.empty() && ref_children.first == ref_children.second) {
+                return;
+            }
+            // Objects that are not deltas were hashed while streaming, they are only read again for their children.
+            if (is_base) {
+                content = read_stored(e);
+            }
+
+            auto shared = budget.share(std::move(content));
+            for (auto child: children) {
+                scheduler.push(worker, task{child, shared});
+            }
+            for (auto child = ref_children.first; child != ref_children.second; ++child) {
+                if (claimed[child - ref_deltas.begin()].exchange(true)) {
+                    continue;
+                }
+                // Set before the child task exists, so its thread and its descendants see it.
+                entries[child->entry].base = e;
+                scheduler.push(worker, task{child->entry, shared});
+            }
+        });
+        return resolved;
+    }
+
+public:
+    explicit pack_indexer(fs::path directory_, std::size_t threads = std::thread::hardware_concurrency()) :
+        directory{std::move(directory_)},
+        thread_count{threads}
+    {}
+
+    /// Bytes of content kept for deltas not yet resolved.
+    void set_memory_limit(std::size_t limit) {
+        memory_limit = limit;
+    }
+
+    std::size_t get_memory_limit() const {
+        return memory_limit;
+    }
+
+    /// Bytes read from the stream at a time, also the inflate output chunk.
+    void set_buffer_size(std::size_t size) {
+        buffer_size = std::max<std::size_t>(size, pack_header::MAX_VARINT_SIZE + OBJECT_NAME_SIZE);
+    }
+
+    /** Reads a whole pack from input and writes it with its index into the directory.
+     *
+     * Throws on corrupt or truncated packs and on thin packs, nothing is left behind.
+     */
+    result index(std::istream& input) const {
+        auto temporary = (directory / "tmp_pack_XXXXXX").string();
+        int spill = ::mkstemp(&temporary[0]);
+        if (spill < 0) {
+            throw std::system_error(errno, std::system_category(), "creating " + temporary);
+        }
+        auto temporary_index = temporary + ".idx";
+
+        result output;
+        try {
+            std::vector<entry> entries;
+            std::vector<ref_delta> ref_deltas;
+            output.checksum = read_pack(input, spill, entries, ref_deltas);
+            ::close(spill);
+            spill = -1;
+
+            auto deltas = std::count_if(entries.begin(), entries.end(), [](const entry& object) {
+                return pack_header::is_delta(object.type);
+            });
+            if (resolve_deltas(temporary, entries, ref_deltas) != static_cast<std::size_t>(deltas)) {
+                throw std::runtime_error("pack has deltas against objects it does not have, thin packs are not supported");
+            }
+
+            std::vector<pack_index_entry> index_entries;
+            index_entries.reserve(entries.size());
+            for (const auto& object: entries) {
+                index_entries.push_back(pack_index_entry{object.name, object.offset, object.crc});
+            }
+            write_pack_index(temporary_index, std::move(index_entries), output.checksum);
+
+            auto base_name = "pack-" + output.checksum.to_string();
+            output.pack_path = directory / (base_name + ".pack");
+            output.index_path = directory / (base_name + ".idx");
+            output.object_count = entries.size();
+
+            auto read_only = fs::perms::owner_read | fs::perms::group_read | fs::perms::others_read;
+            fs::permissions(temporary, read_only);
+            fs::permissions(temporary_index, read_only);
+            // The pack goes first, an index is only found next to its pack.
+            fs::rename(temporary, output.pack_path);
+            fs::rename(temporary_index, output.index_path);
+        } catch (...) {
+            if (spill >= 0) {
+                ::close(spill);
+            }
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            fs::remove(temporary_index, ignored);
+            throw;
+        }
+        return output;
+    }
+};
+
+}
+
+#endif
@@ -5,20 +5,28 @@
 #include <iterator>
 #include <algorithm>
 #include <exception>
+#include <stdexcept>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <utility>
 #include <tuple>
-#include <unordered_map>
+#include <memory>
 
 #include "util/filesystem.hpp"
+#include "util/memory_advice.hpp"
+#include "util/sharded_cache.hpp"
 
 #include "pack/index.hpp"
-#include "util/big_unsigned.hpp"
+#include "pack/delta.hpp"
+#include "pack/delta_base_cache.hpp"
+#include "pack/object_arena.hpp"
+#include "pack/object_header.hpp"
 #include "streams/sources.hpp"
+#include "streams/memory_buffer.hpp"
 #include "streams/iohelper.hpp"
 #include "streams/uncompress_stream.hpp"
+#include "streams/inflate_buffer.hpp"
 #include "object_descriptor.hpp"
 
 
@@ -39,7 +47,7 @@ protected:
 
 public:
     pack_object_descriptor(
-        const std::string& name,
+        const object_id& name,
         unsigned header_size_ = 0,
         uint64_t size_ = 0,
         uint64_t pack_offset = 0,
@@ -52,12 +60,33 @@ public:
         pack_size{pack_size_}
     {}
 
-    const std::string& get_name() const {
+    const object_id& get_name() const override {
         return index_item::get_name();
     }
 
     virtual const std::string& get_type() const = 0;
 
+    /// Reads the whole object content in one go.
+    virtual std::vector<char> read_content() const = 0;
+
+    /** Opens a new stream over the object content.
+     *
+     * Unlike get_stream() each call has its own stream, so threads sharing the descriptor
+     * can read it at the same time.
+     */
+    virtual std::unique_ptr<std::istream> open_stream() const = 0;
+
+    /** Reads the whole object content into destination.
+     *
+     * size must be the size of the content, get_size() for objects that are not deltas.
+     */
+    virtual void read_content(char* destination, size_t size) const = 0;
+
+    /// Pack objects are compressed, the view owns the inflated content.
+    byte_view get_content() override {
+        return byte_view{read_content()};
+    }
+
     operator bool() const {
         return size > 0;
     }
@@ -87,43 +116,23 @@ public:
     virtual object_descriptor_base& get_delta_parent() const = 0;
 };
 
+/** Objects of a pack, found through its index.
+ *
+ * Lookups, open_stream(), read_content() and get_content() can be used from many threads
+ * sharing one loader. get_stream() keeps its stream in the descriptor, it is not meant to
+ * be shared between threads.
+ */
 template <class SOURCE, typename INDEX_T = size_t>
 class pack_loader :
     public index_iterable<pack_loader<SOURCE, INDEX_T>, INDEX_T>
 {
     static constexpr auto TAIL_SIZE = 20; // 20 bytes SHA1 checksum at the end of the file.
+    static constexpr uint64_t RAW_CHUNK_SIZE = 1024 * 1024;
 
     using ITERABLE = index_iterable<pack_loader<SOURCE, INDEX_T>, INDEX_T>;
     using index_parser_type = index_reader_base<SOURCE, INDEX_T>;
 
-    enum git_internal_type {
-        COMMIT = 1,
-        TREE   = 2,
-        BLOB   = 3,
-        TAG    = 4,
-        DELTA_WITH_OFFSET = 6,
-        DELTA_WITH_OBJID  = 7
-    };
-
-    static bool is_delta(git_internal_type type) {
-        return type == DELTA_WITH_OFFSET || type == DELTA_WITH_OBJID;
-    }
-
-    static const std::string& type_name(git_internal_type type) {
-        static const std::string TYPES[] = {
-            "invalid(0)",
-            "commit",
-            "tree",
-            "blob",
-            "tag",
-            "invalid(5)",
-            "delta by offset",
-            "delta by object id"
-        };
-
-        uint8_t index = static_cast<uint8_t>(type);
-        return TYPES[index];
-    }
+    using git_internal_type = pack_header::git_internal_type;
 
 public:
     using source_t = SOURCE;
@@ -132,39 +141,45 @@ public:
     using reference  = typename ITERABLE::reference;
     using pointer    = typename ITERABLE::pointer;
 
+    static const std::string& type_name(uint8_t type) {
+        return pack_header::type_name(type);
+    }
+
 private:
     index_parser_type index_parser;
 
-    using cache_t = std::unordered_map<std::string, std::unique_ptr<pack_object_descriptor>>;
-    using cache_entry_t = cache_t::value_type;
+    using cache_t = sharded_cache<index_type, pack_object_descriptor>;
+    using content_ptr = delta_base_cache::content_ptr;
     // Retrieve objects do no alter this.
     mutable source_t pack_source;
+    mutable object_arena arena;
     mutable cache_t object_cache;
+    mutable delta_base_cache base_cache;
 
+    /// Descriptors only hold what the API hands out, the content is read through the loader.
     class non_delta_object_descriptor : public pack_object_descriptor {
+        const pack_loader& loader;
+        index_type position;
         git_internal_type type;
-        const source_t& source;
         std::unique_ptr<std::istream> stream;
 
     public:
         non_delta_object_descriptor(
-                const source_t& source_,
-                const std::string& name,
-                git_internal_type type_,
-                unsigned header_size = 0,
-                uint64_t size = 0,
-                uint64_t pack_offset = 0,
-                uint64_t pack_size = 0,
-                uint32_t crc = 0) :
+                const pack_loader& loader_,
+                index_type position_,
+                const index_item& item,
+                const object_record& record,
+                uint64_t pack_size) :
             pack_object_descriptor {
-                name,
-                header_size,
-                size,
-                pack_offset,
+                item.get_name(),
+                record.header_size,
+                record.size,
+                item.get_pack_offset(),
                 pack_size,
-                crc },
-            type{type_},
-            source{source_}
+                item.get_crc() },
+            loader{loader_},
+            position{position_},
+            type{static_cast<git_internal_type>(record.type)}
         {}
 
         const std::string& get_type() const override {
@@ -173,148 +188,680 @@ private:
 
         std::istream& get_stream() override {
             if (!stream) {
-                auto size = get_data_size();
-                stream = make_uncompressed_source(source.subsource(get_data_offset(), size)).stream();
+                stream = open_stream();
             }
             return *stream;
         }
 
-        virtual bool has_parent() const {
-            return false;
+        std::unique_ptr<std::istream> open_stream() const override {
+            return make_uncompressed_source(loader.pack_source.subsource(get_data_offset(), get_data_size())).stream();
+        }
+
+        std::vector<char> read_content() const override {
+            return loader.read_content(position);
+        }
+
+        void read_content(char* destination, size_t size) const override {
+            loader.read_content(position, destination, size);
         }
 
-        git_internal_type get_internal_type() const {
-            return type;
+    protected:
+        const pack_loader& get_loader() const {
+            return loader;
+        }
+
+        index_type get_position() const {
+            return position;
         }
     };
 
+    /// The type and depth of its chain are only resolved when asked for.
     class delta_object_descriptor : public non_delta_object_descriptor, public pack_delta_descriptor {
-        unsigned pack_depth = 0;
-        unsigned extra_header = 0;
-        non_delta_object_descriptor& parent;
-        git_internal_type external_type;
-
-        auto external_type_and_depth(unsigned depth = 0) const {
-            if (!parent.has_parent()) {
-                return std::make_pair(parent.get_internal_type(), depth + 1);
+        index_type base;
+
+    public:
+        delta_object_descriptor(
+                const pack_loader& loader,
+                index_type position,
+                const index_item& item,
+                const object_record& record,
+                uint64_t pack_size) :
+            non_delta_object_descriptor{loader, position, item, record, pack_size},
+            base{record.base}
+        {}
+
+        unsigned get_pack_depth() const override {
+            return this->get_loader().resolve_chain(this->get_position()).depth;
+        }
+
+        object_descriptor_base& get_delta_parent() const override {
+            return this->get_loader().load_data(base);
+        }
+
+        const std::string& get_type() const override {
+            return type_name(this->get_loader().resolve_chain(this->get_position()).base_type);
+        }
+
+        /// Streams the object content, rebuilt from its delta chain.
+        std::unique_ptr<std::istream> open_stream() const override {
+            return std::make_unique<shared_memory_istream>(std::make_shared<const std::vector<char>>(this->read_content()));
+        }
+    };
+
+    /// Stands for objects that are not in the pack, its content can not be read.
+    class missing_object_descriptor : public pack_object_descriptor {
+        [[noreturn]] static void missing() {
+            throw std::out_of_range("object not found in pack");
+        }
+
+    public:
+        missing_object_descriptor() :
+            pack_object_descriptor{object_id{}}
+        {}
+
+        const std::string& get_type() const override {
+            return type_name(0);
+        }
+
+        std::istream& get_stream() override {
+            missing();
+        }
+
+        std::unique_ptr<std::istream> open_stream() const override {
+            missing();
+        }
+
+        std::vector<char> read_content() const override {
+            missing();
+        }
+
+        void read_content(char*, size_t) const override {
+            missing();
+        }
+    };
+
+    void check_position(index_type position) const {
+        if (position >= size()) {
+            throw std::out_of_range("pack object position out of range");
+        }
+    }
+
+    /// Longest header before the data of an object: type and size, then a base offset or name.
+    static constexpr size_t MAX_HEADER_SIZE = pack_header::MAX_VARINT_SIZE + OBJECT_NAME_SIZE;
+
+    /** Gets the bytes of the object header at offset.
+     *
+     * Points straight into the pack when it is memory backed, otherwise the header is read
+     * into buffer. end is set past the last available byte.
+     */
+    const uint8_t* header_bytes(uint64_t offset, uint8_t (&buffer)[MAX_HEADER_SIZE], const uint8_t*& end) const {
+        auto data = pack_source.data();
+        if (data) {
+            auto begin = reinterpret_cast<const uint8_t*>(data) + offset;
+            end = reinterpret_cast<const uint8_t*>(data) + pack_source.size().value();
+            return begin;
+        }
+
+        auto input = pack_source.substream(offset);
+        input->read(reinterpret_cast<char*>(buffer), sizeof(buffer));
+        end = buffer + input->gcount();
+        return buffer;
+    }
+
+    /// Decodes the header of the object at position, once, into the arena.
+    object_record load_record(index_type position) const {
+        auto cached = arena.get(position);
+        if (cached) {
+            return *cached;
+        }
+
+        auto offset = index_parser.offset_of(position);
+        uint8_t buffer[MAX_HEADER_SIZE];
+        const uint8_t* end = nullptr;
+        auto current = header_bytes(offset, buffer, end);
+
+        auto header = pack_header::read_object_header(current, end);
+        current += header.length;
+
+        object_record record;
+        record.type = header.type;
+        record.size = header.size;
+        unsigned header_size = header.length;
+
+        auto type = static_cast<git_internal_type>(header.type);
+        if (pack_header::is_delta(type)) {
+            index_type base;
+            if (type == pack_header::DELTA_WITH_OFFSET) {
+                auto base_offset = pack_header::read_delta_offset(current, end);
+                if (base_offset.offset == 0 || base_offset.offset > offset) {
+                    throw std::invalid_argument("corrupt pack: delta base before the start of the pack");
+                }
+                header_size += base_offset.length;
+                base = index_parser.find_offset(offset - base_offset.offset);
+            } else {
+                if (end - current < static_cast<std::ptrdiff_t>(OBJECT_NAME_SIZE)) {
+                    throw std::invalid_argument("corrupt pack: truncated delta base name");
+                }
+                header_size += OBJECT_NAME_SIZE;
+                base = index_parser.find(object_id{current});
+            }
+            if (base == size()) {
+                throw std::runtime_error("delta base not found in pack");
             }
+            record.base = static_cast<uint32_t>(base);
+        } else {
+            record.chain_resolved = true;
+            record.base_type = record.type;
+        }
+        record.header_size = static_cast<uint8_t>(header_size);
 
-            return dynamic_cast<delta_object_descriptor&>(parent).external_type_and_depth(depth + 1);
+        arena.set(position, record);
+        return record;
+    }
+
+    /** Record of the object at position with its delta chain resolved.
+     *
+     * Walks down the chain until an object whose chain is known, then records the base type
+     * and depth of every delta on the way back up. Nothing is loaded beyond the records.
+     */
+    object_record resolve_chain(index_type position) const {
+        auto record = load_record(position);
+        if (record.chain_resolved) {
+            return record;
         }
 
-    protected:
-        bool has_parent() const override {
-            return true;
+        std::vector<index_type> pending;
+        auto current = record;
+        for (auto at = position; !current.chain_resolved; current = load_record(at)) {
+            if (pending.size() > object_record::MAX_DEPTH) {
+                throw std::runtime_error("delta chain too deep or looping");
+            }
+            pending.push_back(at);
+            at = current.base;
+        }
+
+        unsigned depth = current.depth;
+        for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+            arena.set_chain(*it, current.base_type, ++depth);
+        }
+
+        record.chain_resolved = true;
+        record.base_type = current.base_type;
+        record.depth = static_cast<uint16_t>(depth);
+        return record;
+    }
+
+    /// Inflates the data stored in the pack, for deltas that is the delta itself.
+    void inflate(index_type position, const object_record& record, char* destination, size_t size) const {
+        if (size != record.size) {
+            throw std::invalid_argument("destination size does not match the object size");
+        }
+
+        auto offset = index_parser.offset_of(position);
+        auto data_offset = offset + record.header_size;
+        auto data_size = read_pack_size(index_item{offset}) - record.header_size + 1;
+
+        auto data = pack_source.data();
+        if (data) {
+            inflate_into(data + data_offset, data_size, destination, size);
+            return;
+        }
+
+        auto input = make_uncompressed_source(pack_source.subsource(data_offset, data_size)).stream();
+        input->read(destination, size);
+        if (static_cast<size_t>(input->gcount()) != size) {
+            throw std::runtime_error("truncated object in pack");
+        }
+    }
+
+    std::vector<char> inflate(index_type position, const object_record& record) const {
+        std::vector<char> result(record.size);
+        inflate(position, record, result.data(), result.size());
+        return result;
+    }
+
+    /** Rebuilds the base a deltified object applies to.
+     *
+     * Walks the chain towards its base until an object is found in the delta base cache,
+     * then applies the deltas back down. Every intermediate result is cached since sibling
+     * deltas usually share their bases.
+     */
+    content_ptr load_base(const object_record& delta) const {
+        std::vector<std::pair<index_type, object_record>> chain;
+        content_ptr base;
+        index_type current = delta.base;
+        while (!(base = base_cache.get(index_parser.offset_of(current)))) {
+            auto record = load_record(current);
+            if (!record.is_delta()) {
+                base = std::make_shared<const std::vector<char>>(inflate(current, record));
+                base_cache.put(index_parser.offset_of(current), base);
+                break;
+            }
+            if (chain.size() > object_record::MAX_DEPTH) {
+                throw std::runtime_error("delta chain too deep or looping");
+            }
+            chain.emplace_back(current, record);
+            current = record.base;
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            auto delta_data = inflate(it->first, it->second);
+            base = std::make_shared<const std::vector<char>>(apply_delta(*base, delta_data));
+            base_cache.put(index_parser.offset_of(it->first), base);
+        }
+        return base;
+    }
+
+public:
+    /// What the pack stores for the object at position, for deltas that is the delta itself.
+    std::vector<char> read_stored(index_type position) const {
+        check_position(position);
+        return inflate(position, load_record(position));
+    }
+
+    /// Content of the object at position, rebuilt from its delta chain.
+    std::vector<char> read_content(index_type position) const {
+        check_position(position);
+        auto record = load_record(position);
+        if (!record.is_delta()) {
+            return inflate(position, record);
+        }
+        auto base = load_base(record);
+        auto delta_data = inflate(position, record);
+        return apply_delta(base->data(), base->size(), delta_data.data(), delta_data.size());
+    }
+
+    void read_content(index_type position, char* destination, size_t size) const {
+        check_position(position);
+        auto record = load_record(position);
+        if (!record.is_delta()) {
+            inflate(position, record, destination, size);
+            return;
+        }
+        auto base = load_base(record);
+        auto delta_data = inflate(position, record);
+        apply_delta(base->data(), base->size(), delta_data.data(), delta_data.size(), destination, size);
+    }
+
+    /// Size of the pack file, trailing checksum included.
+    uint64_t get_pack_file_size() const {
+        return pack_source.size().value();
+    }
+
+    /** Hands the raw bytes [offset, offset + size) of the pack to callback(data, length).
+     *
+     * Memory backed packs are handed over in one piece, straight from the mapping. Others
+     * are read in chunks of RAW_CHUNK_SIZE bytes.
+     */
+    template <typename CALLBACK>
+    void read_raw(uint64_t offset, uint64_t size, CALLBACK callback) const {
+        if (offset + size > get_pack_file_size()) {
+            throw std::out_of_range("raw pack range out of the pack");
+        }
+
+        auto data = pack_source.data();
+        if (data) {
+            callback(data + offset, size);
+            return;
+        }
+
+        std::vector<char> buffer(std::min<uint64_t>(size, RAW_CHUNK_SIZE));
+        auto input = pack_source.substream(offset);
+        while (size > 0) {
+            auto chunk = std::min<uint64_t>(size, buffer.size());
+            input->read(buffer.data(), chunk);
+            if (static_cast<uint64_t>(input->gcount()) != chunk) {
+                throw std::runtime_error("truncated pack");
+            }
+            callback(static_cast<const char*>(buffer.data()), chunk);
+            size -= chunk;
+        }
+    }
+
+    /// Tells the kernel how the pack bytes [offset, offset + size) will be read, when the pack is mapped.
+    void advise(uint64_t offset, uint64_t size, memory_advice advice) const {
+        auto data = pack_source.data();
+        auto file_size = get_pack_file_size();
+        if (data && offset < file_size) {
+            advise_memory(data + offset, std::min<uint64_t>(size, file_size - offset), advice);
+        }
+    }
+
+    /** An object met walking the pack, read from the index and the arena.
+     *
+     * Unlike descriptors these are plain values, nothing is allocated or kept for them.
+     * get_descriptor() builds the descriptor of the object when one is needed.
+     */
+    class pack_entry {
+        const pack_loader* loader;
+        index_type position;
+        index_item item;
+        object_record record;
+        uint64_t pack_size;
+
+    public:
+        pack_entry(const pack_loader& loader_, index_type position_, uint64_t pack_size_) :
+            loader{&loader_},
+            position{position_},
+            item{loader_.index_parser[position_]},
+            record{loader_.load_record(position_)},
+            pack_size{pack_size_}
+        {}
+
+        /// Position of the object in the index.
+        index_type get_position() const {
+            return position;
+        }
+
+        const object_id& get_name() const {
+            return item.get_name();
+        }
+
+        uint64_t get_pack_offset() const {
+            return item.get_pack_offset();
+        }
+
+        uint32_t get_crc() const {
+            return item.get_crc();
+        }
+
+        /// Type, size and delta base as stored in the pack.
+        const object_record& get_record() const {
+            return record;
+        }
+
+        bool is_delta() const {
+            return record.is_delta();
+        }
+
+        /// Index position of the delta base, only for deltas.
+        index_type get_delta_base() const {
+            return record.base;
+        }
+
+        /// Type of the object, for deltas the one at the end of its chain.
+        const std::string& get_type() const {
+            return type_name(loader->resolve_chain(position).base_type);
+        }
+
+        unsigned get_pack_depth() const {
+            return loader->resolve_chain(position).depth;
+        }
+
+        uint64_t get_size() const {
+            return record.size;
+        }
+
+        uint64_t get_pack_size() const {
+            return pack_size;
+        }
+
+        uint64_t get_data_offset() const {
+            return get_pack_offset() + record.header_size;
+        }
+
+        uint64_t get_data_size() const {
+            return pack_size - record.header_size + 1;
+        }
+
+        pack_object_descriptor& get_descriptor() const {
+            return loader->load_data(position);
+        }
+    };
+
+    /** Walks the objects in the order they are stored in the pack.
+     *
+     * Yields pack_entry values, so a scan of the whole pack does not create a descriptor
+     * per object. With a readahead window the kernel is asked to read that many bytes past
+     * the current object ahead of time, so a scan of a cold pack streams instead of
+     * faulting page after page.
+     */
+    class offset_iterator {
+        const pack_loader* loader = nullptr;
+        const reverse_index* reverse = nullptr;
+        index_type pack_position = 0;
+        uint64_t readahead = 0;
+        uint64_t advised_end = 0;
+
+        uint64_t offset_at(index_type at) const {
+            if (at >= loader->size()) {
+                return loader->get_pack_file_size() - TAIL_SIZE;
+            }
+            return loader->index_parser.offset_of((*reverse)[at]);
         }
 
-        unsigned get_header_size() const override {
-            return non_delta_object_descriptor::get_header_size() + extra_header;
+        void read_ahead() {
+            if (readahead == 0 || pack_position >= loader->size()) {
+                return;
+            }
+            auto offset = offset_at(pack_position);
+            // Asking again once half the window was read keeps the kernel ahead of the scan.
+            if (offset + readahead / 2 >= advised_end) {
+                auto from = std::max(offset, advised_end);
+                advised_end = offset + readahead;
+                loader->advise(from, advised_end - from, memory_advice::will_need);
+            }
         }
 
     public:
-        delta_object_descriptor(
-                const source_t& source,
-                object_descriptor_base& parent_,
-                const std::string& name,
-                git_internal_type type,
-                unsigned header_size,
-                uint64_t size = 0,
-                uint64_t pack_offset = 0,
-                uint64_t pack_size = 0,
-                uint32_t crc = 0,
-                unsigned extra_header_ = 0
-            ) :
-            non_delta_object_descriptor{
-                source,
-                name,
-                type,
-                header_size,
-                size,
-                pack_offset,
-                pack_size,
-                crc
-            },
-            extra_header{extra_header_},
-            parent { dynamic_cast<non_delta_object_descriptor&>(parent_) }
+        using iterator_category = std::input_iterator_tag;
+        using value_type = pack_entry;
+        using difference_type = std::ptrdiff_t;
+        using reference = pack_entry;
+        using pointer = void;
+
+        offset_iterator() = default;
+
+        offset_iterator(const pack_loader& loader_, index_type pack_position_, uint64_t readahead_) :
+            loader{&loader_},
+            reverse{&loader_.index_parser.get_reverse_index()},
+            pack_position{pack_position_},
+            readahead{readahead_}
         {
-            std::tie(external_type, pack_depth) = external_type_and_depth();
+            read_ahead();
         }
 
-        unsigned get_pack_depth() const override {
-            return pack_depth;
+        reference operator*() const {
+            // Objects end where the next one starts, the last one at the trailing checksum.
+            auto pack_size = offset_at(pack_position + 1) - offset_at(pack_position);
+            return pack_entry{*loader, (*reverse)[pack_position], pack_size};
         }
 
-        object_descriptor_base& get_delta_parent() const override {
-            return parent;
+        offset_iterator& operator++() {
+            pack_position++;
+            read_ahead();
+            return *this;
         }
 
-        const std::string& get_type() const override {
-            return type_name(external_type);
+        offset_iterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        /// Position of the current object in the pack, 0 being the first one.
+        index_type get_pack_position() const {
+            return pack_position;
+        }
+
+        bool operator==(const offset_iterator& other) const {
+            return loader == other.loader && pack_position == other.pack_position;
+        }
+
+        bool operator!=(const offset_iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /// Range of every object in pack order, see by_offset().
+    class offset_range {
+        const pack_loader& loader;
+        uint64_t readahead;
+
+    public:
+        offset_range(const pack_loader& loader_, uint64_t readahead_) :
+            loader{loader_},
+            readahead{readahead_}
+        {}
+
+        offset_iterator begin() const {
+            return offset_iterator{loader, 0, readahead};
+        }
+
+        offset_iterator end() const {
+            return offset_iterator{loader, loader.size(), 0};
+        }
+
+        index_type size() const {
+            return loader.size();
+        }
+    };
+
+    /** The objects in ascending pack offset order, through the reverse index.
+     *
+     * Iterating by name jumps all over the pack, this reads it front to back and yields
+     * pack_entry values instead of descriptors. readahead is the window in bytes the kernel
+     * is asked to read ahead, 0 leaves it alone. sequential also marks the whole pack as
+     * read in order, which lets the kernel drop pages behind early; that lasts until
+     * advise() says otherwise.
+     */
+    offset_range by_offset(uint64_t readahead = 0, bool sequential = false) const {
+        if (sequential) {
+            advise(0, get_pack_file_size(), memory_advice::sequential);
         }
+        return offset_range{*this, readahead};
+    }
+
+    /// Bytes [begin, end) of the pack.
+    struct byte_range {
+        uint64_t begin;
+        uint64_t end;
     };
 
-    pack_object_descriptor& load_data(const index_item& item) const {
-        auto it = object_cache.find(item.get_name());
-        if (it == object_cache.end()) {
-            auto pack_input = pack_source.subsource(item.get_pack_offset()).stream();
-
-            big_unsigned_with_type result;
-            result.binread(*pack_input);
-
-            uint8_t type_id = result.get_reserved_bits();
-            auto type = static_cast<git_internal_type>(type_id);
-            size_t size = result.template convert<size_t>();
-
-            if (is_delta(type)) {
-                object_descriptor_base* parent;
-                unsigned extra_header;
-                if (type == DELTA_WITH_OFFSET) {
-                    big_unsigned offset;
-                    offset.binread(*pack_input);
-                    extra_header = offset.size();
-                    parent = &(*this)[item - offset.template convert<size_t>()];
-                } else {
-                    std::string parent_name = read_object_name_from(*pack_input);
-                    extra_header = OBJECT_NAME_SIZE/2;
-                    parent = &(*this)[parent_name];
-                    if (!(parent && *parent)) {
-                        throw "broke!";
-                    }
+    /// What plan_reads() found for a batch of names.
+    struct read_plan {
+        std::vector<index_type> objects; ///< Objects found, once each, in ascending pack offset.
+        std::vector<byte_range> ranges;  ///< Bytes of the objects and of their delta bases, ascending.
+        std::size_t missing = 0;         ///< Names that are not in this pack.
+    };
+
+    /// Ranges closer than this are read as one, the gap is cheaper to read than to seek over.
+    static constexpr uint64_t PLAN_MERGE_GAP = 64 * 1024;
+
+    /** Plans the reads of many objects so the pack is read front to back.
+     *
+     * The objects are sorted by pack offset and their delta chains followed down to the
+     * bases, which only decodes headers. The bytes every object needs are gathered into
+     * ranges, to be read ahead with read_planned().
+     */
+    template <typename ID_IT>
+    read_plan plan_reads(ID_IT first, ID_IT last) const {
+        read_plan plan;
+        std::vector<uint64_t> offsets;
+        for (const auto& found: index_parser.find_all(first, last, lookup_order::pack_offset)) {
+            if (!found) {
+                plan.missing++;
+                continue;
+            }
+            // Sorted by offset, the same name asked twice comes twice in a row.
+            if (!plan.objects.empty() && plan.objects.back() == found.position) {
+                continue;
+            }
+            plan.objects.push_back(found.position);
+
+            auto at = found.position;
+            for (unsigned depth = 0; ; depth++) {
+                if (depth > object_record::MAX_DEPTH) {
+                    throw std::runtime_error("delta chain too deep or looping");
+                }
+                offsets.push_back(index_parser.offset_of(at));
+                auto record = load_record(at);
+                if (!record.is_delta()) {
+                    break;
                 }
+                at = record.base;
+            }
+        }
+
+        std::sort(offsets.begin(), offsets.end());
+        offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+        for (auto offset: offsets) {
+            auto end = offset + read_pack_size(index_item{offset});
+            if (!plan.ranges.empty() && offset <= plan.ranges.back().end + PLAN_MERGE_GAP) {
+                plan.ranges.back().end = std::max(plan.ranges.back().end, end);
+            } else {
+                plan.ranges.push_back(byte_range{offset, end});
+            }
+        }
+        return plan;
+    }
+
+    template <typename CONTAINER>
+    read_plan plan_reads(const CONTAINER& names) const {
+        return plan_reads(std::begin(names), std::end(names));
+    }
+
+    /** Reads the objects of a plan in pack order.
+     *
+     * The kernel is first asked to read in every range of the plan, then
+     * callback(name, type, content) is called for each object with its content rebuilt.
+     * Bases shared by many of the objects are rebuilt once through the delta base cache.
+     * Returns the number of objects read.
+     */
+    template <typename CALLBACK>
+    std::size_t read_planned(const read_plan& plan, CALLBACK callback) const {
+        for (const auto& range: plan.ranges) {
+            advise(range.begin, range.end - range.begin, memory_advice::will_need);
+        }
+
+        for (auto position: plan.objects) {
+            auto record = resolve_chain(position);
+            auto content = read_content(position);
+            callback(index_parser[position].get_name(), type_name(record.base_type), content);
+        }
+        return plan.objects.size();
+    }
+
+    /// Reads many objects in pack order, see plan_reads() and read_planned(). Missing names are skipped.
+    template <typename CONTAINER, typename CALLBACK>
+    std::size_t read_all(const CONTAINER& names, CALLBACK callback) const {
+        return read_planned(plan_reads(names), callback);
+    }
+
+    /// Checksum stored at the end of the pack.
+    object_id get_pack_checksum() const {
+        object_id result;
+        read_raw(get_pack_file_size() - TAIL_SIZE, TAIL_SIZE, [&result](const char* data, uint64_t) {
+            result = object_id{reinterpret_cast<const uint8_t*>(data)};
+        });
+        return result;
+    }
+
+private:
+
+    /// Descriptor of the object at position, the one of size() stands for missing objects.
+    pack_object_descriptor& load_data(index_type position) const {
+        auto found = object_cache.find(position);
+        if (found) {
+            return *found;
+        }
 
-                cache_entry_t entry {
-                        item.get_name(),
-                        std::make_unique<delta_object_descriptor>(
-                                pack_source,
-                                *parent,
-                                item.get_name(),
-                                type,
-                                result.size(),
-                                size,
-                                item.get_pack_offset(),
-                                read_pack_size(item),
-                                item.get_crc(),
-                                extra_header
-                        )};
-                it = object_cache.insert(std::move(entry)).first;
+        std::unique_ptr<pack_object_descriptor> descriptor;
+        if (position >= size()) {
+            position = size();
+            descriptor = std::make_unique<missing_object_descriptor>();
+        } else {
+            auto item = index_parser[position];
+            auto record = load_record(position);
+            if (record.is_delta()) {
+                descriptor = std::make_unique<delta_object_descriptor>(*this, position, item, record, read_pack_size(item));
             } else {
-                it = object_cache.emplace(
-                        item.get_name(),
-                        std::make_unique<non_delta_object_descriptor>(
-                            pack_source,
-                            item.get_name(),
-                            type,
-                            result.size(),
-                            size,
-                            item.get_pack_offset(),
-                            read_pack_size(item),
-                            item.get_crc()
-                        )
-                ).first;
+                descriptor = std::make_unique<non_delta_object_descriptor>(*this, position, item, record, read_pack_size(item));
             }
         }
 
-        return *it->second;
+        // When another thread loaded the same object meanwhile its descriptor is kept.
+        return object_cache.insert(position, std::move(descriptor));
     }
 
     size_t read_pack_size(index_item index) const {
@@ -335,18 +882,74 @@ public:
     pack_loader(index_parser_type&& index_parser_instance, ARGS&&... args) :
         ITERABLE(*this),
         index_parser(std::move(index_parser_instance)),
-        pack_source(std::forward<ARGS>(args)...)
+        pack_source(std::forward<ARGS>(args)...),
+        arena(index_parser.size())
     {}
 
     index_type size() const {
         return index_parser.size();
     }
 
-    template <typename ITEM_ID>
-    auto& operator[](ITEM_ID index) const {
-        auto index_found = index_parser[index];
+    const index_parser_type& get_index() const {
+        return index_parser;
+    }
+
+    /// Bytes of delta bases kept in memory to rebuild deltified objects, 0 disables the cache.
+    void set_delta_base_cache_limit(size_t limit) {
+        base_cache.set_limit(limit);
+    }
 
-        return load_data(index_found);
+    size_t get_delta_base_cache_limit() const {
+        return base_cache.get_limit();
+    }
+
+    /** Finds many objects at once.
+     *
+     * In input order the result has one entry per name, nullptr for missing objects. In
+     * pack offset order only the objects found are returned so they can be read sequentially.
+     */
+    template <typename ID_IT>
+    std::vector<pack_object_descriptor*> find_all(ID_IT first, ID_IT last, lookup_order order = lookup_order::input) const {
+        std::vector<pack_object_descriptor*> result;
+        for (const auto& found: index_parser.find_all(first, last, order)) {
+            if (found) {
+                result.push_back(&load_data(found.position));
+            } else if (order == lookup_order::input) {
+                result.push_back(nullptr);
+            }
+        }
+        return result;
+    }
+
+    template <typename CONTAINER>
+    auto find_all(const CONTAINER& names, lookup_order order = lookup_order::input) const {
+        return find_all(std::begin(names), std::end(names), order);
+    }
+
+    /// Type, size and delta base of the object at position, without creating its descriptor.
+    object_record get_record(index_type position) const {
+        check_position(position);
+        return load_record(position);
+    }
+
+    /// Like get_record(), with the base type and depth of its delta chain filled in.
+    object_record get_resolved_record(index_type position) const {
+        check_position(position);
+        return resolve_chain(position);
+    }
+
+    template <typename ITEM_ID>
+    auto& operator[](ITEM_ID id) const {
+        if constexpr (std::is_integral_v<ITEM_ID>) {
+            return load_data(static_cast<index_type>(id));
+        } else if constexpr (std::is_same_v<ITEM_ID, index_item>) {
+            return load_data(index_parser.find_offset(id.get_pack_offset()));
+        } else if constexpr (std::is_same_v<ITEM_ID, object_id>) {
+            return load_data(index_parser.find(id));
+        } else {
+            auto item = index_parser[id];
+            return load_data(item ? index_parser.find(item.get_name()) : size());
+        }
     }
 };
 
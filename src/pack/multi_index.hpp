@@ -0,0 +1,238 @@
+#ifndef PACK_MULTI_INDEX_HPP_INCLUDED
+#define PACK_MULTI_INDEX_HPP_INCLUDED
+
+#include "util/buffer.hpp"
+#include "util/filesystem.hpp"
+#include "streams/file_source.hpp"
+#include "object_id.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace git {
+
+constexpr auto MULTI_PACK_INDEX_FILE_NAME = "multi-pack-index";
+
+/** git multi-pack-index reader.
+ *
+ * The file is mapped and its chunks are read in place. A single binary search maps an
+ * object name to the pack that holds it and its offset in that pack.
+ */
+class multi_index_reader {
+public:
+    static constexpr uint32_t SIGNATURE = 0x4d494458; // "MIDX"
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint8_t SHA1_HASH_VERSION = 1;
+
+    static constexpr uint32_t PACK_NAMES_CHUNK    = 0x504e414d; // "PNAM"
+    static constexpr uint32_t FANOUT_CHUNK        = 0x4f494446; // "OIDF"
+    static constexpr uint32_t NAMES_CHUNK         = 0x4f49444c; // "OIDL"
+    static constexpr uint32_t OFFSETS_CHUNK       = 0x4f4f4646; // "OOFF"
+    static constexpr uint32_t LARGE_OFFSETS_CHUNK = 0x4c4f4646; // "LOFF"
+
+    static constexpr std::size_t HEADER_SIZE = 12;
+    static constexpr std::size_t CHUNK_ENTRY_SIZE = 12;
+    static constexpr std::size_t FANOUT_SIZE = 256 * 4;
+    static constexpr std::size_t OFFSET_ENTRY_SIZE = 8;
+    static constexpr std::size_t LARGE_OFFSET_SIZE = 8;
+
+    // Offsets with this bit set are positions in the large offset chunk.
+    static constexpr uint32_t LARGE_OFFSET_FLAG = 0x80000000;
+
+    /// Where an object is stored.
+    struct location {
+        uint32_t pack;   ///< Position of the pack in get_pack_names().
+        uint64_t offset; ///< Offset in that pack, 0 if the object is not present.
+
+        explicit operator bool() const {
+            return offset != 0;
+        }
+    };
+
+private:
+    file_mapper<char> mapped_file;
+    const uint8_t* fanout = nullptr;
+    const uint8_t* names = nullptr;
+    const uint8_t* offsets = nullptr;
+    uint64_t fanout_size = 0;
+    uint64_t names_size = 0;
+    uint64_t offsets_size = 0;
+    const uint8_t* large_offsets = nullptr;
+    std::size_t large_offsets_count = 0;
+    std::size_t count = 0;
+    std::vector<std::string> pack_names;
+
+    [[noreturn]] void invalid(const std::string& reason) const {
+        throw std::invalid_argument("invalid multi-pack-index: " + reason);
+    }
+
+    uint32_t fanout_at(unsigned bucket) const {
+        return utils::from_netorder<uint32_t>(fanout + bucket * 4);
+    }
+
+    void load_pack_names(const uint8_t* begin, const uint8_t* end, uint32_t expected) {
+        auto current = begin;
+        while (pack_names.size() < expected && current < end) {
+            auto terminator = static_cast<const uint8_t*>(std::memchr(current, 0, end - current));
+            if (!terminator) {
+                invalid("unterminated pack name");
+            }
+            pack_names.emplace_back(reinterpret_cast<const char*>(current), terminator - current);
+            current = terminator + 1;
+        }
+        if (pack_names.size() != expected) {
+            invalid("missing pack names");
+        }
+    }
+
+public:
+    explicit multi_index_reader(const fs::path& path) :
+        mapped_file{path}
+    {
+        auto data = reinterpret_cast<const uint8_t*>(mapped_file.get());
+        auto size = mapped_file.size();
+
+        if (size < HEADER_SIZE || utils::from_netorder<uint32_t>(data) != SIGNATURE) {
+            invalid("bad signature");
+        }
+        if (data[4] != VERSION || data[5] != SHA1_HASH_VERSION) {
+            invalid("unsupported version");
+        }
+        if (data[7] != 0) {
+            invalid("incremental multi-pack-index chains are not supported");
+        }
+
+        unsigned chunks = data[6];
+        uint32_t packs = utils::from_netorder<uint32_t>(data + 8);
+        if (HEADER_SIZE + (chunks + 1) * CHUNK_ENTRY_SIZE > size) {
+            invalid("truncated chunk table");
+        }
+
+        const uint8_t* pack_names_chunk = nullptr;
+        const uint8_t* pack_names_end = nullptr;
+        auto entry = data + HEADER_SIZE;
+        for (unsigned i = 0; i < chunks; i++, entry += CHUNK_ENTRY_SIZE) {
+            auto id = utils::from_netorder<uint32_t>(entry);
+            auto start = utils::from_netorder<uint64_t>(entry + 4);
+            auto finish = utils::from_netorder<uint64_t>(entry + 4 + CHUNK_ENTRY_SIZE);
+            if (start > finish || finish > size) {
+                invalid("chunk out of bounds");
+            }
+
+            switch (id) {
+            case PACK_NAMES_CHUNK:
+                pack_names_chunk = data + start;
+                pack_names_end = data + finish;
+                break;
+            case FANOUT_CHUNK:
+                fanout = data + start;
+                fanout_size = finish - start;
+                break;
+            case NAMES_CHUNK:
+                names = data + start;
+                names_size = finish - start;
+                break;
+            case OFFSETS_CHUNK:
+                offsets = data + start;
+                offsets_size = finish - start;
+                break;
+            case LARGE_OFFSETS_CHUNK:
+                large_offsets = data + start;
+                large_offsets_count = (finish - start) / LARGE_OFFSET_SIZE;
+                break;
+            default:
+                break; // Optional chunks (reverse index, bitmaps...) are ignored.
+            }
+        }
+
+        if (!pack_names_chunk || !fanout || !names || !offsets) {
+            invalid("missing required chunk");
+        }
+
+        load_pack_names(pack_names_chunk, pack_names_end, packs);
+
+        // Every lookup trusts the fanout and the chunk sizes it implies.
+        if (fanout_size != FANOUT_SIZE) {
+            invalid("fanout chunk has the wrong size");
+        }
+        for (unsigned bucket = 1; bucket < 256; bucket++) {
+            if (fanout_at(bucket) < fanout_at(bucket - 1)) {
+                invalid("fanout is not sorted");
+            }
+        }
+        count = fanout_at(255);
+        if (names_size != uint64_t{count} * OBJECT_NAME_SIZE) {
+            invalid("object names chunk has the wrong size");
+        }
+        if (offsets_size != uint64_t{count} * OFFSET_ENTRY_SIZE) {
+            invalid("object offsets chunk has the wrong size");
+        }
+    }
+
+    /// Number of objects.
+    std::size_t size() const {
+        return count;
+    }
+
+    /// Index file names of the packs covered, in the order used by location::pack.
+    const std::vector<std::string>& get_pack_names() const {
+        return pack_names;
+    }
+
+    object_id get_name(std::size_t position) const {
+        return object_id{names + position * OBJECT_NAME_SIZE};
+    }
+
+    location get_location(std::size_t position) const {
+        auto entry = offsets + position * OFFSET_ENTRY_SIZE;
+        location result{utils::from_netorder<uint32_t>(entry), utils::from_netorder<uint32_t>(entry + 4)};
+        if (result.pack >= pack_names.size()) {
+            invalid("pack id out of range");
+        }
+
+        // git only writes the large offset chunk when some offset needs more than 32 bits,
+        // without it offsets up to 4GiB are stored as they are.
+        if (large_offsets && (result.offset & LARGE_OFFSET_FLAG)) {
+            auto large = result.offset & ~LARGE_OFFSET_FLAG;
+            if (large >= large_offsets_count) {
+                invalid("large offset entry out of range");
+            }
+            result.offset = utils::from_netorder<uint64_t>(large_offsets + large * LARGE_OFFSET_SIZE);
+        }
+        return result;
+    }
+
+    /// Position of an object, size() if it is not present.
+    std::size_t find(const object_id& name) const {
+        std::size_t first = name[0] > 0 ? fanout_at(name[0] - 1) : 0;
+        std::size_t last = fanout_at(name[0]);
+
+        while (first < last) {
+            auto middle = first + (last - first) / 2;
+            auto cmp = std::memcmp(names + middle * OBJECT_NAME_SIZE, name.data(), OBJECT_NAME_SIZE);
+            if (cmp == 0) {
+                return middle;
+            } else if (cmp < 0) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return count;
+    }
+
+    location operator[](const object_id& name) const {
+        auto position = find(name);
+        if (position == count) {
+            return location{0, 0};
+        }
+        return get_location(position);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef PACK_MULTI_INDEX_WRITER_HPP_INCLUDED
+#define PACK_MULTI_INDEX_WRITER_HPP_INCLUDED
+
+#include "pack/index.hpp"
+#include "pack/loader.hpp"
+#include "pack/multi_index.hpp"
+#include "util/filesystem.hpp"
+#include "util/sha1.hpp"
+#include "object_id.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace git {
+
+/** Writes a multi-pack-index covering a set of pack indexes.
+ *
+ * The indexes are already sorted by name so they are combined with a k-way merge that
+ * only holds one cursor per pack. The merge runs twice: the first pass sizes the chunks
+ * and the second one streams each chunk to its place in the file.
+ *
+ * When an object is in more than one pack the pack with the lowest priority value wins.
+ */
+template <class INDEX>
+class multi_index_writer {
+    using index_type = typename INDEX::index_type;
+
+    static constexpr std::size_t CHUNK_COUNT_WITHOUT_LARGE = 4;
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    struct pack_entry {
+        std::string name;
+        const INDEX* index;
+        unsigned priority;
+    };
+
+    struct cursor {
+        object_id name;
+        uint32_t pack;
+        index_type position;
+    };
+
+    std::vector<pack_entry> packs;
+
+    template <typename CALLBACK>
+    void merge(CALLBACK callback) const {
+        auto later = [this](const cursor& a, const cursor& b) {
+            if (a.name != b.name) {
+                return b.name < a.name;
+            }
+            return packs[b.pack].priority < packs[a.pack].priority;
+        };
+        std::priority_queue<cursor, std::vector<cursor>, decltype(later)> heap{later};
+
+        auto push = [&](uint32_t pack, index_type position) {
+            if (position < packs[pack].index->size()) {
+                heap.push(cursor{(*packs[pack].index)[position].get_name(), pack, position});
+            }
+        };
+
+        for (uint32_t pack = 0; pack < packs.size(); pack++) {
+            push(pack, 0);
+        }
+
+        object_id last;
+        bool first = true;
+        while (!heap.empty()) {
+            auto current = heap.top();
+            heap.pop();
+            push(current.pack, current.position + 1);
+
+            if (!first && current.name == last) {
+                continue; // Duplicate from a pack with lower precedence.
+            }
+            first = false;
+            last = current.name;
+            callback(current.name, current.pack, (*packs[current.pack].index)[current.position].get_pack_offset());
+        }
+    }
+
+    /// Buffered writer for one chunk, flushed with pwrite at the chunk position.
+    class chunk_output {
+        int fd;
+        uint64_t position;
+        std::vector<uint8_t> buffer;
+
+    public:
+        chunk_output(int fd_, uint64_t position_) :
+            fd{fd_},
+            position{position_}
+        {
+            buffer.reserve(BUFFER_SIZE);
+        }
+
+        void write(const uint8_t* data, std::size_t size) {
+            if (buffer.size() + size > BUFFER_SIZE) {
+                flush();
+            }
+            buffer.insert(buffer.end(), data, data + size);
+        }
+
+        template <typename INT>
+        void write_netorder(INT value) {
+            uint8_t bytes[sizeof(INT)];
+            for (int i = sizeof(INT) - 1; i >= 0; i--) {
+                bytes[i] = static_cast<uint8_t>(value & 0xff);
+                value >>= 8;
+            }
+            write(bytes, sizeof(bytes));
+        }
+
+        void flush() {
+            auto data = buffer.data();
+            auto remaining = buffer.size();
+            while (remaining > 0) {
+                auto written = ::pwrite(fd, data, remaining, position);
+                if (written < 0) {
+                    throw std::system_error(errno, std::system_category(), "writing multi-pack-index");
+                }
+                data += written;
+                remaining -= written;
+                position += written;
+            }
+            buffer.clear();
+        }
+    };
+
+public:
+    /// Adds a pack, they must be added sorted by name. Lower priority wins duplicates.
+    void add_pack(const std::string& index_name, const INDEX& index, unsigned priority) {
+        if (!packs.empty() && !(packs.back().name < index_name)) {
+            throw std::invalid_argument("packs must be added sorted by name");
+        }
+        packs.push_back(pack_entry{index_name, &index, priority});
+    }
+
+    void write(const fs::path& path) const {
+        std::array<uint32_t, 256> fanout{};
+        uint32_t count = 0;
+        uint32_t large_count = 0;
+        bool large_needed = false;
+        merge([&](const object_id& name, uint32_t, uint64_t offset) {
+            fanout[name[0]]++;
+            count++;
+            if (offset >= multi_index_reader::LARGE_OFFSET_FLAG) {
+                large_count++;
+            }
+            large_needed |= offset > UINT32_MAX;
+        });
+        // As git does, offsets up to 4GiB are written in place unless some offset needs more
+        // than 32 bits. Then every offset with the top bit set goes to the large offset chunk.
+        if (!large_needed) {
+            large_count = 0;
+        }
+        for (unsigned i = 1; i < fanout.size(); i++) {
+            fanout[i] += fanout[i - 1];
+        }
+
+        std::vector<uint8_t> pack_names;
+        for (const auto& pack: packs) {
+            pack_names.insert(pack_names.end(), pack.name.begin(), pack.name.end());
+            pack_names.push_back(0);
+        }
+        pack_names.resize((pack_names.size() + 3) / 4 * 4, 0);
+
+        auto chunks = CHUNK_COUNT_WITHOUT_LARGE + (large_count > 0 ? 1 : 0);
+        uint64_t names_chunk = multi_index_reader::HEADER_SIZE + (chunks + 1) * multi_index_reader::CHUNK_ENTRY_SIZE;
+        uint64_t fanout_chunk = names_chunk + pack_names.size();
+        uint64_t ids_chunk = fanout_chunk + multi_index_reader::FANOUT_SIZE;
+        uint64_t offsets_chunk = ids_chunk + uint64_t{count} * OBJECT_NAME_SIZE;
+        uint64_t large_chunk = offsets_chunk + uint64_t{count} * multi_index_reader::OFFSET_ENTRY_SIZE;
+        uint64_t end = large_chunk + uint64_t{large_count} * multi_index_reader::LARGE_OFFSET_SIZE;
+
+        auto temporary = path;
+        temporary += ".lock";
+        // Like git's lockfile, a writer already at work makes this one fail.
+        int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_EXCL, 0444);
+        if (fd < 0) {
+            throw std::system_error(errno, std::system_category(), "creating " + temporary.string());
+        }
+
+        try {
+            chunk_output header{fd, 0};
+            header.write_netorder(multi_index_reader::SIGNATURE);
+            header.write_netorder(multi_index_reader::VERSION);
+            header.write_netorder(multi_index_reader::SHA1_HASH_VERSION);
+            header.write_netorder(static_cast<uint8_t>(chunks));
+            header.write_netorder(uint8_t{0}); // No base multi-pack-index.
+            header.write_netorder(static_cast<uint32_t>(packs.size()));
+
+            auto chunk_entry = [&header](uint32_t id, uint64_t offset) {
+                header.write_netorder(id);
+                header.write_netorder(offset);
+            };
+            chunk_entry(multi_index_reader::PACK_NAMES_CHUNK, names_chunk);
+            chunk_entry(multi_index_reader::FANOUT_CHUNK, fanout_chunk);
+            chunk_entry(multi_index_reader::NAMES_CHUNK, ids_chunk);
+            chunk_entry(multi_index_reader::OFFSETS_CHUNK, offsets_chunk);
+            if (large_count > 0) {
+                chunk_entry(multi_index_reader::LARGE_OFFSETS_CHUNK, large_chunk);
+            }
+            chunk_entry(0, end);
+
+            header.write(pack_names.data(), pack_names.size());
+            for (auto value: fanout) {
+                header.write_netorder(value);
+            }
+            header.flush();
+
+            chunk_output ids{fd, ids_chunk};
+            chunk_output offsets{fd, offsets_chunk};
+            chunk_output large_offsets{fd, large_chunk};
+            uint32_t large_written = 0;
+            merge([&](const object_id& name, uint32_t pack, uint64_t offset) {
+                ids.write(name.data(), name.size());
+                offsets.write_netorder(pack);
+                if (large_needed && offset >= multi_index_reader::LARGE_OFFSET_FLAG) {
+                    offsets.write_netorder(multi_index_reader::LARGE_OFFSET_FLAG | large_written++);
+                    large_offsets.write_netorder(offset);
+                } else {
+                    offsets.write_netorder(static_cast<uint32_t>(offset));
+                }
+            });
+            ids.flush();
+            offsets.flush();
+            large_offsets.flush();
+
+            sha1 checksum;
+            std::vector<uint8_t> buffer(BUFFER_SIZE);
+            for (uint64_t position = 0; position < end;) {
+                auto got = ::pread(fd, buffer.data(), std::min<uint64_t>(buffer.size(), end - position), position);
+                if (got <= 0) {
+                    throw std::system_error(errno, std::system_category(), "reading back multi-pack-index");
+                }
+                checksum.update(buffer.data(), got);
+                position += got;
+            }
+            chunk_output trailer{fd, end};
+            auto digest = checksum.finish();
+            trailer.write(digest.data(), digest.size());
+            trailer.flush();
+        } catch (...) {
+            ::close(fd);
+            fs::remove(temporary);
+            throw;
+        }
+
+        ::close(fd);
+        fs::rename(temporary, path);
+    }
+};
+
+/** Writes the multi-pack-index of every pack in a directory.
+ *
+ * Duplicated objects are taken from preferred_pack (an .idx or .pack file name) when it
+ * has them, otherwise from the most recently modified pack.
+ */
+inline void write_multi_index(const fs::path& directory, const std::string& preferred_pack = "") {
+    using index_t = decltype(index_file_parser(std::declval<fs::path>()));
+
+    std::vector<fs::path> paths;
+    for (const auto& entry: fs::directory_iterator(directory)) {
+        auto path = entry.path();
+        if (path.extension() == INDEX_FILE_EXTENSION && fs::exists(get_pack_path(path))) {
+            paths.push_back(path);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<fs::file_time_type> times;
+    for (const auto& path: paths) {
+        times.push_back(fs::last_write_time(get_pack_path(path)));
+    }
+    std::vector<unsigned> by_age(paths.size());
+    for (unsigned i = 0; i < by_age.size(); i++) {
+        by_age[i] = i;
+    }
+    std::stable_sort(by_age.begin(), by_age.end(), [&times](auto a, auto b) {
+        return times[a] > times[b];
+    });
+
+    std::vector<unsigned> priority(paths.size());
+    for (unsigned rank = 0; rank < by_age.size(); rank++) {
+        auto pack = by_age[rank];
+        auto preferred = !preferred_pack.empty() &&
+            (paths[pack].filename() == preferred_pack || get_pack_path(paths[pack]).filename() == preferred_pack);
+        priority[pack] = preferred ? 0 : rank + 1;
+    }
+
+    std::vector<index_t> indexes;
+    indexes.reserve(paths.size());
+    multi_index_writer<index_t> writer;
+    for (std::size_t i = 0; i < paths.size(); i++) {
+        indexes.push_back(index_file_parser(paths[i]));
+        writer.add_pack(paths[i].filename().string(), indexes.back(), priority[i]);
+    }
+    writer.write(directory / MULTI_PACK_INDEX_FILE_NAME);
+}
+
+}
+
+#endif
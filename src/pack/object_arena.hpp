@@ -0,0 +1,122 @@
+#ifndef PACK_OBJECT_ARENA_HPP_INCLUDED
+#define PACK_OBJECT_ARENA_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace git {
+
+/// What the header of a pack object says about it.
+struct object_record {
+    static constexpr uint32_t NO_BASE = 0xffffffff;
+    static constexpr unsigned MAX_DEPTH = 0xffff;
+
+    uint64_t size = 0;        ///< Inflated size, for deltas the size of the delta itself.
+    uint32_t base = NO_BASE;  ///< Index position of the delta base.
+    uint8_t type = 0;         ///< Type code as stored in the pack.
+    uint8_t header_size = 0;  ///< Bytes before the compressed data, delta base included.
+
+    // Known once the delta chain was resolved, always for objects that are not deltas.
+    bool chain_resolved = false;
+    uint8_t base_type = 0;    ///< Type code of the object at the end of the delta chain.
+    uint16_t depth = 0;       ///< Deltas down to that object.
+
+    bool is_delta() const {
+        return base != NO_BASE;
+    }
+};
+
+/** Records of every object of a pack, indexed by index position.
+ *
+ * Each record takes two words: the size, then everything else packed together with a flag
+ * telling the record is set. Records are filled lazily and can be read and set from many
+ * threads, concurrent writers of a record store the same values.
+ */
+class object_arena {
+    // Second word: base (32) | depth (16) | header size (8) | base type (3) | resolved | type (3) | loaded
+    static constexpr uint64_t LOADED = 1;
+    static constexpr unsigned TYPE_SHIFT = 1;
+    static constexpr uint64_t RESOLVED = 1 << 4;
+    static constexpr unsigned BASE_TYPE_SHIFT = 5;
+    static constexpr unsigned HEADER_SIZE_SHIFT = 8;
+    static constexpr unsigned DEPTH_SHIFT = 16;
+    static constexpr unsigned BASE_SHIFT = 32;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    std::size_t count = 0;
+
+    static uint64_t chain_bits(uint8_t base_type, unsigned depth) {
+        return RESOLVED | uint64_t{base_type & 0x07u} << BASE_TYPE_SHIFT | uint64_t{depth} << DEPTH_SHIFT;
+    }
+
+    static uint64_t pack(const object_record& record) {
+        auto packed = uint64_t{record.base} << BASE_SHIFT
+            | uint64_t{record.header_size} << HEADER_SIZE_SHIFT
+            | uint64_t{record.type & 0x07u} << TYPE_SHIFT
+            | LOADED;
+        if (record.chain_resolved) {
+            packed |= chain_bits(record.base_type, record.depth);
+        }
+        return packed;
+    }
+
+    void check_position(std::size_t position) const {
+        if (position >= count) {
+            throw std::out_of_range("object arena position out of range");
+        }
+    }
+
+public:
+    static constexpr std::size_t BYTES_PER_OBJECT = 2 * sizeof(uint64_t);
+
+    explicit object_arena(std::size_t count_ = 0) :
+        words{std::make_unique<std::atomic<uint64_t>[]>(2 * count_)},
+        count{count_}
+    {}
+
+    std::size_t size() const {
+        return count;
+    }
+
+    /// The record at position, nothing if it was not set yet.
+    std::optional<object_record> get(std::size_t position) const {
+        check_position(position);
+        auto packed = words[2 * position + 1].load(std::memory_order_acquire);
+        if (!(packed & LOADED)) {
+            return std::nullopt;
+        }
+
+        object_record result;
+        result.size = words[2 * position].load(std::memory_order_relaxed);
+        result.base = static_cast<uint32_t>(packed >> BASE_SHIFT);
+        result.header_size = static_cast<uint8_t>(packed >> HEADER_SIZE_SHIFT);
+        result.type = (packed >> TYPE_SHIFT) & 0x07;
+        result.chain_resolved = packed & RESOLVED;
+        result.base_type = (packed >> BASE_TYPE_SHIFT) & 0x07;
+        result.depth = static_cast<uint16_t>(packed >> DEPTH_SHIFT);
+        return result;
+    }
+
+    void set(std::size_t position, const object_record& record) {
+        check_position(position);
+        words[2 * position].store(record.size, std::memory_order_relaxed);
+        words[2 * position + 1].store(pack(record), std::memory_order_release);
+    }
+
+    /// Records the end of the delta chain of an object that is already set.
+    void set_chain(std::size_t position, uint8_t base_type, unsigned depth) {
+        check_position(position);
+        if (depth > object_record::MAX_DEPTH) {
+            throw std::overflow_error("delta chain too deep");
+        }
+        words[2 * position + 1].fetch_or(chain_bits(base_type, depth), std::memory_order_release);
+    }
+};
+
+}
+
+#endif
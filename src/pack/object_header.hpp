@@ -0,0 +1,117 @@
+#ifndef PACK_OBJECT_HEADER_HPP_INCLUDED
+#define PACK_OBJECT_HEADER_HPP_INCLUDED
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace git {
+
+namespace pack_header {
+
+/// Type codes of pack objects.
+enum git_internal_type {
+    COMMIT = 1,
+    TREE   = 2,
+    BLOB   = 3,
+    TAG    = 4,
+    DELTA_WITH_OFFSET = 6,
+    DELTA_WITH_OBJID  = 7
+};
+
+constexpr bool is_delta(uint8_t type) {
+    return type == DELTA_WITH_OFFSET || type == DELTA_WITH_OBJID;
+}
+
+/// Name of a type code, the one git hashes for objects that are not deltas.
+inline const std::string& type_name(uint8_t type) {
+    static const std::string TYPES[] = {
+        "invalid(0)",
+        "commit",
+        "tree",
+        "blob",
+        "tag",
+        "invalid(5)",
+        "delta by offset",
+        "delta by object id"
+    };
+
+    return TYPES[type & 0x07];
+}
+
+/// Longest encoding of a 64 bit value, for both the type and size header and delta offsets.
+constexpr unsigned MAX_VARINT_SIZE = 10;
+
+/// Type and inflated size that start every object of a pack.
+struct object_header {
+    uint8_t type = 0;
+    uint64_t size = 0;
+    unsigned length = 0; ///< Bytes used by the header.
+};
+
+/** Decodes the type and size header of a pack object.
+ *
+ * The first byte holds the type in bits 4-6 and the low 4 bits of the size, each next byte
+ * adds 7 more bits of the size (little endian) while the MSB is set.
+ */
+constexpr object_header read_object_header(const uint8_t* data, const uint8_t* end) {
+    if (data == end) {
+        throw std::invalid_argument("corrupt pack: truncated object header");
+    }
+
+    auto current = data;
+    uint8_t byte = *current++;
+    object_header result;
+    result.type = (byte >> 4) & 0x07;
+    result.size = byte & 0x0f;
+
+    unsigned shift = 4;
+    while (byte & 0x80) {
+        if (current == end || shift >= 64) {
+            throw std::invalid_argument("corrupt pack: bad object header");
+        }
+        byte = *current++;
+        if (shift > 57 && (byte & 0x7f) >> (64 - shift) != 0) {
+            throw std::invalid_argument("corrupt pack: object size over 64 bits");
+        }
+        result.size |= uint64_t(byte & 0x7f) << shift;
+        shift += 7;
+    }
+    result.length = static_cast<unsigned>(current - data);
+    return result;
+}
+
+/// Distance back to the base of an OFS_DELTA object.
+struct delta_offset {
+    uint64_t offset = 0;
+    unsigned length = 0; ///< Bytes used by the encoded offset.
+};
+
+/** Decodes the base offset of an OFS_DELTA object.
+ *
+ * Big endian, 7 bits per byte while the MSB is set. Each continuation adds one before
+ * shifting so there is a single encoding for every value.
+ */
+constexpr delta_offset read_delta_offset(const uint8_t* data, const uint8_t* end) {
+    if (data == end) {
+        throw std::invalid_argument("corrupt pack: truncated delta offset");
+    }
+
+    auto current = data;
+    uint8_t byte = *current++;
+    uint64_t offset = byte & 0x7f;
+    while (byte & 0x80) {
+        if (current == end || offset >= (uint64_t{1} << 57) - 1) {
+            throw std::invalid_argument("corrupt pack: bad delta offset");
+        }
+        byte = *current++;
+        offset = ((offset + 1) << 7) | (byte & 0x7f);
+    }
+    return {offset, static_cast<unsigned>(current - data)};
+}
+
+}
+
+}
+
+#endif
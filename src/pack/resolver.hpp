@@ -0,0 +1,126 @@
+#ifndef PACK_RESOLVER_HPP_INCLUDED
+#define PACK_RESOLVER_HPP_INCLUDED
+
+#include "pack/delta.hpp"
+#include "pack/delta_forest.hpp"
+#include "pack/object_arena.hpp"
+#include "util/work_stealing.hpp"
+#include "object_id.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace git {
+
+/** Rebuilds every object of a pack, like git index-pack does.
+ *
+ * The object headers give the forest of deltas: objects that are not deltas are the roots
+ * and each delta is a child of its base. Every tree is walked from its root, so each
+ * object is inflated once and its content handed to all its children while it is hot.
+ * Trees are spread over threads with a work stealing scheduler.
+ *
+ * Contents waiting for their children are limited by a memory budget. Over budget the
+ * children rebuild their base through the loader instead, which is slower but bounded.
+ */
+template <class LOADER>
+class pack_resolver {
+public:
+    using index_type = typename LOADER::index_type;
+    using content_ptr = content_budget::content_ptr;
+
+    static constexpr std::size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+private:
+    struct task {
+        index_type position;
+        uint8_t type;        ///< Type of the object at the root of the tree.
+        content_ptr base;    ///< Content of the base of a delta, nullptr when over budget.
+    };
+
+    const LOADER& loader;
+    std::size_t thread_count;
+    std::size_t memory_limit = DEFAULT_MEMORY_LIMIT;
+    delta_forest<index_type> forest;
+
+public:
+    explicit pack_resolver(const LOADER& loader_, std::size_t threads = std::thread::hardware_concurrency()) :
+        loader{loader_},
+        thread_count{threads},
+        // Records are kept by the loader, reading them twice is cheap.
+        forest{loader_.size(), [&loader_](std::size_t position) {
+            auto record = loader_.get_record(static_cast<index_type>(position));
+            return record.is_delta() ? static_cast<index_type>(record.base) : delta_forest<index_type>::ROOT;
+        }}
+    {}
+
+    /// Bytes of content kept for children not yet resolved.
+    void set_memory_limit(std::size_t limit) {
+        memory_limit = limit;
+    }
+
+    std::size_t get_memory_limit() const {
+        return memory_limit;
+    }
+
+    /// Number of objects that are not deltas, each one is the root of a delta tree.
+    std::size_t root_count() const {
+        return forest.get_roots().size();
+    }
+
+    /** Rebuilds every object of the pack.
+     *
+     * callback(name, type, content) is called once per object, from the worker threads and
+     * possibly at the same time. An exception from the callback or a corrupt object stops
+     * the resolution and is rethrown here.
+     */
+    template <typename CALLBACK>
+    void resolve(CALLBACK callback) const {
+        content_budget budget{memory_limit};
+        work_stealing_scheduler<task> scheduler{thread_count};
+
+        const auto& roots = forest.get_roots();
+        for (std::size_t i = 0; i < roots.size(); i++) {
+            scheduler.push(i, task{roots[i], 0, nullptr});
+        }
+
+        scheduler.run([&](std::size_t worker, task& current) {
+            auto position = current.position;
+            std::vector<char> content;
+            uint8_t type = current.type;
+            auto record = loader.get_record(position);
+            if (!record.is_delta()) {
+                content = loader.read_stored(position);
+                type = record.type;
+            } else {
+                auto delta_data = loader.read_stored(position);
+                auto base = current.base;
+                if (!base) {
+                    base = std::make_shared<const std::vector<char>>(loader.read_content(record.base));
+                }
+                content = apply_delta(*base, delta_data);
+            }
+
+            auto name = loader.get_index()[position].get_name();
+            callback(name, LOADER::type_name(type), content);
+
+            auto children = forest.children_of(position);
+            if (children.empty()) {
+                return;
+            }
+
+            auto shared = budget.share(std::move(content));
+            for (auto child: children) {
+                scheduler.push(worker, task{child, type, shared});
+            }
+        });
+    }
+};
+
+}
+
+#endif
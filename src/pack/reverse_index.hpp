@@ -0,0 +1,176 @@
+#ifndef PACK_REVERSE_INDEX_HPP_INCLUDED
+#define PACK_REVERSE_INDEX_HPP_INCLUDED
+
+#include "util/buffer.hpp"
+#include "util/filesystem.hpp"
+#include "util/sha1.hpp"
+#include "streams/file_source.hpp"
+#include "object_id.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace git {
+
+constexpr auto REVERSE_INDEX_FILE_EXTENSION = ".rev";
+
+/** Pack order to index position mapping.
+ *
+ * Entry i is the index position of the i-th object in the pack (ascending offsets). It is
+ * either a flat array computed from the index offsets or the contents of a git .rev file,
+ * read in place from its mapping.
+ */
+class reverse_index {
+    static constexpr uint32_t MAGIC = 0x52494458; // "RIDX"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t SHA1_HASH_ID = 1;
+    static constexpr std::size_t HEADER_SIZE = 12;
+    static constexpr std::size_t ENTRY_SIZE = 4;
+    static constexpr std::size_t TRAILER_SIZE = 2 * OBJECT_NAME_SIZE;
+
+    std::vector<uint32_t> positions;
+
+    std::shared_ptr<file_mapper<char>> mapped_file;
+    const uint8_t* mapped = nullptr;
+    std::size_t count = 0;
+
+public:
+    reverse_index() = default;
+
+    /// Builds the reverse index from the offset of each index position.
+    template <typename OFFSET_OF>
+    static reverse_index build(std::size_t count, OFFSET_OF offset_of) {
+        std::vector<uint64_t> offsets(count);
+        for (std::size_t i = 0; i < count; i++) {
+            offsets[i] = offset_of(i);
+        }
+
+        reverse_index result;
+        result.positions.resize(count);
+        std::iota(result.positions.begin(), result.positions.end(), 0);
+        std::sort(result.positions.begin(), result.positions.end(), [&offsets](auto a, auto b) {
+            return offsets[a] < offsets[b];
+        });
+        result.count = count;
+        return result;
+    }
+
+    /** Maps a git .rev file, the entries are read in place.
+     *
+     * The file must be for the pack with the given checksum and every entry must be an
+     * index position, otherwise a stale or corrupt file would give a wrong pack order.
+     */
+    static reverse_index load(const fs::path& path, std::size_t expected_count, const object_id& pack_checksum) {
+        reverse_index result;
+        result.mapped_file = std::make_shared<file_mapper<char>>(path);
+        result.mapped = reinterpret_cast<const uint8_t*>(result.mapped_file->get());
+        result.count = expected_count;
+
+        auto invalid = [&path](const std::string& reason) {
+            return std::invalid_argument("invalid reverse index file " + path.string() + ": " + reason);
+        };
+
+        auto size = result.mapped_file->size();
+        if (size != HEADER_SIZE + expected_count * ENTRY_SIZE + TRAILER_SIZE
+                || utils::from_netorder<uint32_t>(result.mapped) != MAGIC
+                || utils::from_netorder<uint32_t>(result.mapped + 4) != VERSION
+                || utils::from_netorder<uint32_t>(result.mapped + 8) != SHA1_HASH_ID) {
+            throw invalid("bad header or size");
+        }
+        result.mapped += HEADER_SIZE;
+
+        if (object_id{result.mapped + expected_count * ENTRY_SIZE} != pack_checksum) {
+            throw invalid("written for another pack");
+        }
+        for (std::size_t i = 0; i < expected_count; i++) {
+            if (result[i] >= expected_count) {
+                throw invalid("entry out of range");
+            }
+        }
+        return result;
+    }
+
+    /// Writes the reverse index in git's .rev format.
+    void write(const fs::path& path, const object_id& pack_checksum) const {
+        std::vector<uint8_t> contents(HEADER_SIZE + count * ENTRY_SIZE);
+        auto put = [&contents](std::size_t at, uint32_t value) {
+            for (int i = 3; i >= 0; i--) {
+                contents[at + i] = static_cast<uint8_t>(value & 0xff);
+                value >>= 8;
+            }
+        };
+
+        put(0, MAGIC);
+        put(4, VERSION);
+        put(8, SHA1_HASH_ID);
+        for (std::size_t i = 0; i < count; i++) {
+            put(HEADER_SIZE + i * ENTRY_SIZE, (*this)[i]);
+        }
+
+        sha1 checksum;
+        checksum.update(contents.data(), contents.size());
+        checksum.update(pack_checksum.data(), pack_checksum.size());
+        auto file_checksum = checksum.finish();
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+        out.write(reinterpret_cast<const char*>(pack_checksum.data()), pack_checksum.size());
+        out.write(reinterpret_cast<const char*>(file_checksum.data()), file_checksum.size());
+        if (!out) {
+            throw std::runtime_error("could not write reverse index " + path.string());
+        }
+    }
+
+    /// Index position of the object at the given pack position.
+    uint32_t operator[](std::size_t pack_position) const {
+        if (mapped) {
+            return utils::from_netorder<uint32_t>(mapped + pack_position * ENTRY_SIZE);
+        }
+        return positions[pack_position];
+    }
+
+    /** Pack position of the object that starts at offset, size() if there is none.
+     *
+     * The offsets are retrieved through offset_of(index position).
+     */
+    template <typename OFFSET_OF>
+    std::size_t find(uint64_t offset, OFFSET_OF offset_of) const {
+        std::size_t first = 0;
+        std::size_t last = count;
+        while (first < last) {
+            auto middle = first + (last - first) / 2;
+            auto found = offset_of((*this)[middle]);
+            if (found == offset) {
+                return middle;
+            } else if (found < offset) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return count;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    bool is_mapped() const {
+        return mapped != nullptr;
+    }
+};
+
+template <typename PATH>
+fs::path get_reverse_index_path(PATH file) {
+    fs::path file_path{file};
+    file_path.replace_extension(REVERSE_INDEX_FILE_EXTENSION);
+    return file_path;
+}
+
+}
+
+#endif
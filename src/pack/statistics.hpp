@@ -0,0 +1,108 @@
+#ifndef PACK_STATISTICS_HPP_INCLUDED
+#define PACK_STATISTICS_HPP_INCLUDED
+
+#include "object_id.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace git {
+
+/// Counts and histograms of a pack, as collect_pack_statistics() finds them.
+struct pack_statistics {
+    static constexpr std::size_t TYPE_COUNT = 8;    ///< Type codes take 3 bits.
+    static constexpr std::size_t SIZE_BUCKETS = 65; ///< Bucket b > 0 counts sizes in [2^(b-1), 2^b).
+
+    uint64_t object_count = 0;
+    uint64_t delta_count = 0;
+
+    // By type code as stored, deltas counted by their delta type.
+    std::array<uint64_t, TYPE_COUNT> stored_count{};
+    std::array<uint64_t, TYPE_COUNT> stored_size{};  ///< Inflated bytes, for deltas of the deltas themselves.
+    std::array<uint64_t, TYPE_COUNT> packed_size{};  ///< Bytes in the pack, headers included.
+
+    /// Objects by the type they have once rebuilt, deltas counted as the type of their base.
+    std::array<uint64_t, TYPE_COUNT> object_type_count{};
+
+    /// Inflated size of what is stored, in power of two buckets.
+    std::array<uint64_t, SIZE_BUCKETS> size_histogram{};
+
+    /// Objects by length of their delta chain, 0 for objects that are not deltas.
+    std::vector<uint64_t> chain_length_histogram;
+
+    /// Objects by how many deltas have them as their base.
+    std::vector<uint64_t> fan_out_histogram;
+
+    /// Object most deltas use as base, with how many.
+    object_id widest_base;
+    uint64_t widest_fan_out = 0;
+
+    static std::size_t size_bucket(uint64_t size) {
+        std::size_t bucket = 0;
+        for (; size > 0; size >>= 1) {
+            bucket++;
+        }
+        return bucket;
+    }
+};
+
+/** Scans a pack, decoding only object headers.
+ *
+ * Objects are walked in pack order through the reverse index so the headers are read
+ * sequentially. Delta chains are resolved from the records the loader keeps, nothing is
+ * inflated.
+ */
+template <class LOADER>
+pack_statistics collect_pack_statistics(const LOADER& loader) {
+    using index_type = typename LOADER::index_type;
+
+    pack_statistics result;
+    const auto& index = loader.get_index();
+    const auto& reverse = index.get_reverse_index();
+    auto count = loader.size();
+    auto objects_end = loader.get_pack_file_size() - OBJECT_NAME_SIZE;
+
+    auto count_in = [](std::vector<uint64_t>& histogram, std::size_t value) {
+        if (histogram.size() <= value) {
+            histogram.resize(value + 1, 0);
+        }
+        histogram[value]++;
+    };
+
+    std::vector<uint32_t> fan_out(count, 0);
+    result.object_count = count;
+    uint64_t next_offset = count > 0 ? index.offset_of(reverse[0]) : objects_end;
+    for (index_type pack_position = 0; pack_position < count; pack_position++) {
+        auto position = static_cast<index_type>(reverse[pack_position]);
+        auto offset = next_offset;
+        next_offset = pack_position + 1 < count ? index.offset_of(reverse[pack_position + 1]) : objects_end;
+
+        auto record = loader.get_resolved_record(position);
+        result.stored_count[record.type]++;
+        result.stored_size[record.type] += record.size;
+        result.packed_size[record.type] += next_offset - offset;
+        result.object_type_count[record.base_type]++;
+        result.size_histogram[pack_statistics::size_bucket(record.size)]++;
+        count_in(result.chain_length_histogram, record.depth);
+
+        if (record.is_delta()) {
+            result.delta_count++;
+            fan_out[record.base]++;
+        }
+    }
+
+    for (index_type position = 0; position < count; position++) {
+        count_in(result.fan_out_histogram, fan_out[position]);
+        if (fan_out[position] > result.widest_fan_out) {
+            result.widest_fan_out = fan_out[position];
+            result.widest_base = index[position].get_name();
+        }
+    }
+    return result;
+}
+
+}
+
+#endif
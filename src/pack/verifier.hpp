@@ -0,0 +1,160 @@
+#ifndef PACK_VERIFIER_HPP_INCLUDED
+#define PACK_VERIFIER_HPP_INCLUDED
+
+#include "pack/resolver.hpp"
+#include "util/crc32.hpp"
+#include "util/sha1.hpp"
+#include "util/sha1dc.hpp"
+#include "util/work_stealing.hpp"
+#include "object_id.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace git {
+
+/// What verify_pack() found.
+struct pack_verification {
+    object_id stored_checksum;    ///< Checksum at the end of the pack.
+    object_id computed_checksum;  ///< SHA-1 of everything before it.
+    object_id index_checksum;     ///< Pack checksum the index was built for.
+    std::vector<object_id> corrupt_objects; ///< Sorted names of objects that do not hash to their name.
+    std::vector<object_id> crc_mismatches;  ///< Sorted names of objects whose raw bytes fail the index CRC.
+
+    bool checksum_matches() const {
+        return computed_checksum == stored_checksum && index_checksum == stored_checksum;
+    }
+
+    bool ok() const {
+        return checksum_matches() && corrupt_objects.empty() && crc_mismatches.empty();
+    }
+};
+
+/// SHA-1 of the whole pack but its trailing checksum, read straight from the mapping.
+template <class LOADER>
+object_id compute_pack_checksum(const LOADER& loader) {
+    sha1 checksum;
+    loader.read_raw(0, loader.get_pack_file_size() - OBJECT_NAME_SIZE, [&checksum](const char* data, uint64_t size) {
+        checksum.update(data, size);
+    });
+    return checksum.finish();
+}
+
+/** Checks the raw bytes of every object against the CRC32 the index has for it.
+ *
+ * Nothing is inflated, this only catches damage to the pack, cheaply. Objects are walked
+ * in pack order, split in runs of about TASK_BYTES spread over threads. Returns the sorted
+ * names of the objects that fail.
+ */
+template <class LOADER>
+std::vector<object_id> find_crc_mismatches(const LOADER& loader, std::size_t threads = std::thread::hardware_concurrency()) {
+    using index_type = typename LOADER::index_type;
+    static constexpr uint64_t TASK_BYTES = 8 * 1024 * 1024;
+
+    struct run {
+        index_type first; ///< Pack positions [first, last).
+        index_type last;
+    };
+
+    const auto& index = loader.get_index();
+    const auto& reverse = index.get_reverse_index();
+    auto count = loader.size();
+    auto objects_end = loader.get_pack_file_size() - OBJECT_NAME_SIZE;
+    auto offset_at = [&](index_type pack_position) {
+        return pack_position < count ? index.offset_of(reverse[pack_position]) : objects_end;
+    };
+
+    work_stealing_scheduler<run> scheduler{threads};
+    index_type first = 0;
+    auto first_offset = offset_at(0);
+    for (index_type pack_position = 1; pack_position <= count; pack_position++) {
+        auto offset = offset_at(pack_position);
+        if (offset - first_offset >= TASK_BYTES || pack_position == count) {
+            scheduler.push(first, run{first, pack_position});
+            first = pack_position;
+            first_offset = offset;
+        }
+    }
+
+    std::mutex lock;
+    std::vector<object_id> mismatches;
+    scheduler.run([&](std::size_t, run& current) {
+        auto end = offset_at(current.first);
+        for (auto pack_position = current.first; pack_position < current.last; pack_position++) {
+            auto begin = end;
+            end = offset_at(pack_position + 1);
+
+            crc32_checksum crc;
+            loader.read_raw(begin, end - begin, [&crc](const char* data, uint64_t size) {
+                crc.update(data, size);
+            });
+
+            auto item = index[reverse[pack_position]];
+            if (crc.value() != item.get_crc()) {
+                std::lock_guard<std::mutex> guard{lock};
+                mismatches.push_back(item.get_name());
+            }
+        }
+    });
+
+    std::sort(mismatches.begin(), mismatches.end());
+    return mismatches;
+}
+
+/** Rebuilds every object of the pack and checks it hashes to its name.
+ *
+ * Objects are rebuilt with pack_resolver, so each one is inflated once. Returns the sorted
+ * names of the objects whose "<type> <size>\0" header and content hash to something else.
+ *
+ * Names are checked with collision detection, as git does: an object crafted with a SHA-1
+ * collision attack throws sha1_collision_error.
+ */
+template <class LOADER>
+std::vector<object_id> find_corrupt_objects(const LOADER& loader, std::size_t threads = std::thread::hardware_concurrency()) {
+    std::mutex lock;
+    std::vector<object_id> corrupt;
+
+    pack_resolver<LOADER> resolver{loader, threads};
+    resolver.resolve([&](const object_id& name, const std::string& type, const std::vector<char>& content) {
+        if (hash_object(type, content.data(), content.size()) != name) {
+            std::lock_guard<std::mutex> guard{lock};
+            corrupt.push_back(name);
+        }
+    });
+
+    std::sort(corrupt.begin(), corrupt.end());
+    return corrupt;
+}
+
+/** Checks the pack checksum, that the index belongs to the pack, every object CRC and name.
+ *
+ * The pack checksum is computed on its own thread while the objects are checked. When some
+ * CRC fails the objects are not rebuilt, damaged data would only make that throw. Objects
+ * that can not be rebuilt at all, like corrupt deflate streams, throw.
+ */
+template <class LOADER>
+pack_verification verify_pack(const LOADER& loader, std::size_t threads = std::thread::hardware_concurrency()) {
+    auto checksum = std::async(std::launch::async, [&loader]() {
+        return compute_pack_checksum(loader);
+    });
+
+    pack_verification result;
+    result.stored_checksum = loader.get_pack_checksum();
+    result.index_checksum = loader.get_index().get_pack_checksum();
+    result.crc_mismatches = find_crc_mismatches(loader, threads);
+    if (result.crc_mismatches.empty()) {
+        result.corrupt_objects = find_corrupt_objects(loader, threads);
+    }
+    result.computed_checksum = checksum.get();
+    return result;
+}
+
+}
+
+#endif
@@ -2,7 +2,10 @@
 #define FILE_SOURCE_HPP_INCLUDED
 
 #include "streams/sources.hpp"
+#include "util/byte_view.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <functional>
 #include <streambuf>
@@ -45,10 +48,9 @@ public:
         close();
     }
 
-    file_descriptor(file_descriptor&& f) {
-        close();
-        fd = f.fd;
-    }
+    file_descriptor(file_descriptor&& f) :
+        fd{f.reset()}
+    {}
 
     file_descriptor& operator=(file_descriptor&& other) {
         close();
@@ -111,32 +113,36 @@ public:
         return mapped_memory.get();
     }
 
-    auto size() {
+    size_t size() const {
         return my_size;
     }
+
+    /// View of part of the mapping, it stays mapped while the view is alive.
+    byte_view view(size_t offset, size_t length) const {
+        return byte_view{mapped_memory, reinterpret_cast<const char*>(get()) + offset, length};
+    }
 };
 
+/** Stream buffer over a window of a mapped file.
+ *
+ * The whole window is the get area so reads go straight to the mapping, without copies
+ * and without a virtual call per character.
+ */
 class mapped_file_buffer : public std::streambuf {
     using mapper_t = file_mapper<typename traits_type::char_type>;
 
     mapper_t mapped_file;
-    size_t start;
-    size_t finish;
-    size_t current;
-    char_type hold = 0;
 
 public:
     mapped_file_buffer(mapper_t mfile, size_t offset, size_t len) :
-        mapped_file{std::move(mfile)},
-        start{offset},
-        finish{offset + len},
-        current{offset}
+        mapped_file{std::move(mfile)}
     {
-        setg(&hold,  &hold, &hold);
+        auto begin = mapped_file.get() + offset;
+        setg(begin, begin, begin + len);
     }
 
     mapped_file_buffer(mapper_t mfile, size_t offset) :
-        mapped_file_buffer{std::move(mfile), offset, mfile.size() - offset}
+        mapped_file_buffer{mfile, offset, mfile.size() - offset}
     {}
 
     mapped_file_buffer(fs::path file) :
@@ -144,33 +150,40 @@ public:
     {}
 
 protected:
-    int_type underflow() override
-    {
-        if (current == finish) {
+    int_type underflow() override {
+        if (gptr() == egptr()) {
             return traits_type::eof();
         }
-        hold = mapped_file[current++];
-        setg(&hold, &hold, &hold+1);
-        return traits_type::to_int_type(hold);
+        return traits_type::to_int_type(*gptr());
     }
 
-    pos_type seekpos(pos_type off, std::ios_base::openmode witch) override {
-        if (witch == std::ios_base::out) {
-            return 0;
-        }
-        current = static_cast<pos_type>(off);
-        return current - start;
+    std::streamsize showmanyc() override {
+        auto remaining = egptr() - gptr();
+        return remaining > 0 ? remaining : -1;
     }
 
-    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode witch) override {
-        if (witch == std::ios_base::out) {
-            return 0;
-        }
-        current = (dir == std::ios_base::beg ? start : dir == std::ios_base::end ? finish : current) + off;
-        return current - start;
+    std::streamsize xsgetn(char_type* destination, std::streamsize count) override {
+        auto available = std::min<std::streamsize>(count, egptr() - gptr());
+        std::memcpy(destination, gptr(), available);
+        // gbump takes an int, windows can be larger than that.
+        setg(eback(), gptr() + available, egptr());
+        return available;
     }
 
+    pos_type seekpos(pos_type position, std::ios_base::openmode witch) override {
+        off_type offset = position;
+        if (!(witch & std::ios_base::in) || offset < 0 || offset > egptr() - eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + offset, egptr());
+        return position;
+    }
 
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode witch) override {
+        off_type base = dir == std::ios_base::beg ? 0 :
+            dir == std::ios_base::end ? egptr() - eback() : gptr() - eback();
+        return seekpos(base + off, witch);
+    }
 };
 
 class file_device : public device {
@@ -184,11 +197,15 @@ public:
     {}
 
     std::optional<size_t> size() const override {
-        return file_size(file_path);
+        return map.size();
+    }
+
+    const char* data() const override {
+        return map.get();
     }
 
     std::unique_ptr<std::streambuf> create_limited_buffer(size_t start, std::optional<size_t> length) override {
-        size_t sz = length.value_or(start - size().value_or(0));
+        size_t sz = length.value_or(map.size() - start);
         return std::make_unique<mapped_file_buffer>(map, start, sz);
     }
 };
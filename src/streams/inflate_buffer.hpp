@@ -0,0 +1,269 @@
+#ifndef INFLATE_BUFFER_HPP_INCLUDED
+#define INFLATE_BUFFER_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+namespace git {
+
+/** Per thread pool of zlib inflate states.
+ *
+ * Setting up a z_stream allocates its window, for packs with many small objects that
+ * dominates the cost of reading them. Released states are reset and handed out again.
+ */
+class inflater_pool {
+    struct end_inflate {
+        void operator()(z_stream* stream) const {
+            inflateEnd(stream);
+            delete stream;
+        }
+    };
+
+public:
+    using stream_ptr = std::unique_ptr<z_stream, end_inflate>;
+
+private:
+    static constexpr std::size_t MAX_IDLE = 16;
+
+    std::vector<stream_ptr> idle;
+
+    static inflater_pool& local() {
+        static thread_local inflater_pool pool;
+        return pool;
+    }
+
+public:
+    /// Inflate state ready for a new zlib stream, returned to the pool of the releasing thread.
+    class handle {
+        stream_ptr stream;
+
+    public:
+        explicit handle(stream_ptr stream_) :
+            stream{std::move(stream_)}
+        {}
+
+        handle(handle&&) = default;
+        handle& operator=(handle&&) = default;
+
+        ~handle() {
+            if (stream) {
+                local().release(std::move(stream));
+            }
+        }
+
+        z_stream* operator->() const {
+            return stream.get();
+        }
+
+        z_stream* get() const {
+            return stream.get();
+        }
+    };
+
+    static handle acquire() {
+        auto& pool = local();
+        if (!pool.idle.empty()) {
+            auto stream = std::move(pool.idle.back());
+            pool.idle.pop_back();
+            if (inflateReset(stream.get()) == Z_OK) {
+                return handle{std::move(stream)};
+            }
+        }
+
+        stream_ptr stream{new z_stream{}};
+        if (inflateInit(stream.get()) != Z_OK) {
+            throw std::bad_alloc();
+        }
+        return handle{std::move(stream)};
+    }
+
+    void release(stream_ptr stream) {
+        if (idle.size() < MAX_IDLE) {
+            idle.push_back(std::move(stream));
+        }
+    }
+
+    /// Number of states waiting to be reused by this thread.
+    static std::size_t idle_count() {
+        return local().idle.size();
+    }
+};
+
+/** Inflates a whole zlib stream in one go when its uncompressed size is known.
+ *
+ * The output goes straight into destination, which must be exactly size bytes.
+ * Throws std::runtime_error for corrupt data or when the size does not match.
+ */
+inline void inflate_into(const char* compressed, std::size_t compressed_size, char* destination, std::size_t size) {
+    auto zlib = inflater_pool::acquire();
+    zlib->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed));
+    // zlib refuses a null output even when there is nothing to write (empty objects).
+    char empty;
+    zlib->next_out = reinterpret_cast<Bytef*>(destination ? destination : &empty);
+
+    // avail_in and avail_out are 32 bits, larger objects go in pieces.
+    auto input_left = compressed_size;
+    auto output_left = size;
+    int status;
+    do {
+        auto input_piece = std::min<std::size_t>(input_left, UINT32_MAX);
+        auto output_piece = std::min<std::size_t>(output_left, UINT32_MAX);
+        zlib->avail_in = static_cast<uInt>(input_piece);
+        zlib->avail_out = static_cast<uInt>(output_piece);
+
+        auto flush = input_piece == input_left && output_piece == output_left ? Z_FINISH : Z_NO_FLUSH;
+        status = inflate(zlib.get(), flush);
+
+        auto consumed = input_piece - zlib->avail_in;
+        auto produced = output_piece - zlib->avail_out;
+        input_left -= consumed;
+        output_left -= produced;
+
+        if (status != Z_OK && status != Z_STREAM_END) {
+            if (status == Z_BUF_ERROR) {
+                throw std::runtime_error(output_left == 0 ? "inflate failed: object larger than expected" : "inflate failed: truncated data");
+            }
+            throw std::runtime_error(std::string("inflate failed: ") + (zlib->msg ? zlib->msg : "corrupt data"));
+        }
+        if (status == Z_OK && consumed == 0 && produced == 0) {
+            throw std::runtime_error("inflate failed: truncated data");
+        }
+    } while (status != Z_STREAM_END);
+
+    if (output_left != 0) {
+        throw std::runtime_error("inflate failed: object smaller than expected");
+    }
+}
+
+/** Stream buffer inflating a zlib stream.
+ *
+ * When the compressed data is in memory (a mapped pack) zlib reads it in place, otherwise
+ * it is read in blocks from the input buffer.
+ */
+class inflate_buffer : public std::streambuf {
+    static constexpr std::size_t BUFFER_SIZE = 16 * 1024;
+
+    std::unique_ptr<std::streambuf> input;
+    inflater_pool::handle zlib;
+    std::vector<char> input_block;
+    const char* pending = nullptr; // Compressed data in memory not yet given to zlib.
+    std::size_t pending_size = 0;
+    char output[BUFFER_SIZE];
+    std::size_t skip;
+    std::optional<std::size_t> remaining;
+    bool finished = false;
+
+    bool refill_input() {
+        if (pending) {
+            if (pending_size == 0) {
+                return false;
+            }
+            // avail_in is 32 bits, larger spans are given in pieces.
+            auto piece = std::min<std::size_t>(pending_size, UINT32_MAX);
+            zlib->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pending));
+            zlib->avail_in = static_cast<uInt>(piece);
+            pending += piece;
+            pending_size -= piece;
+            return true;
+        }
+        auto got = input->sgetn(input_block.data(), input_block.size());
+        if (got <= 0) {
+            return false;
+        }
+        zlib->next_in = reinterpret_cast<Bytef*>(input_block.data());
+        zlib->avail_in = static_cast<uInt>(got);
+        return true;
+    }
+
+    std::size_t inflate_some() {
+        zlib->next_out = reinterpret_cast<Bytef*>(output);
+        zlib->avail_out = sizeof(output);
+
+        while (!finished && zlib->avail_out == sizeof(output)) {
+            if (zlib->avail_in == 0 && !refill_input()) {
+                finished = true;
+                break;
+            }
+            auto status = inflate(zlib.get(), Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                finished = true;
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("inflate failed: ") + (zlib->msg ? zlib->msg : "corrupt data"));
+            }
+        }
+        return sizeof(output) - zlib->avail_out;
+    }
+
+public:
+    /**
+     * @param input_ buffer reading the compressed data, kept alive by this buffer.
+     * @param data compressed data already in memory or nullptr to read it from input_.
+     * @param size size of data.
+     * @param start uncompressed bytes to skip.
+     * @param length maximum uncompressed bytes to read.
+     */
+    inflate_buffer(
+            std::unique_ptr<std::streambuf> input_,
+            const char* data,
+            std::size_t size,
+            std::size_t start = 0,
+            std::optional<std::size_t> length = std::nullopt) :
+        input{std::move(input_)},
+        zlib{inflater_pool::acquire()},
+        skip{start},
+        remaining{length}
+    {
+        zlib->next_in = nullptr;
+        zlib->avail_in = 0;
+        if (data) {
+            pending = data;
+            pending_size = size;
+        } else {
+            input_block.resize(BUFFER_SIZE);
+        }
+        setg(output, output, output);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        std::size_t produced;
+        char* begin;
+        do {
+            if (remaining && *remaining == 0) {
+                return traits_type::eof();
+            }
+            produced = inflate_some();
+            if (produced == 0) {
+                return traits_type::eof();
+            }
+            begin = output;
+            auto skipped = std::min(skip, produced);
+            skip -= skipped;
+            begin += skipped;
+            produced -= skipped;
+        } while (produced == 0);
+
+        if (remaining) {
+            produced = std::min(produced, *remaining);
+            *remaining -= produced;
+        }
+        setg(output, begin, begin + produced);
+        return traits_type::to_int_type(*gptr());
+    }
+};
+
+}
+
+#endif
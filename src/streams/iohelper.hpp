@@ -1,7 +1,10 @@
 #ifndef IOHELPER_HPP_INCLUDED
 #define IOHELPER_HPP_INCLUDED
 
+#include "object_id.hpp"
+
 #include <ios>
+#include <istream>
 
 namespace git {
 
@@ -17,39 +20,9 @@ template <typename UNSIGNED_TYPE, typename SOURCE,
     return utils::from_buffer<UNSIGNED_TYPE>(buffer);
 }
 
-namespace {
-
-inline char hex_digit (unsigned val) {
-    char v = val & 0x0f;
-    if (v < 10) {
-        return '0' + v;
-    } else {
-        return 'a' + (v - 10);
-    }
-}
-
-inline auto hex_value(char d) {
-    if (d >= 'a' && d <= 'f') { return d - 'a' + 10; }
-    if (d >= 'A' && d <= 'F') { return d - 'A' + 10; }
-    if (d >= '0' && d <= '9') { return d - '0'; }
-    return 0;
-}
-
-}
-
 inline auto read_object_name_from(std::istream& input) {
-    char buffer[OBJECT_NAME_SIZE];
-    input.read(buffer, OBJECT_NAME_SIZE);
-
-    std::string result(OBJECT_NAME_SIZE * 2, ' ');
-    auto it = result.begin();
-    for (char v: buffer) {
-        *it = hex_digit(v >> 4);
-        it++;
-        *it = hex_digit(v & 0x0f);
-        it++;
-    }
-
+    object_id result;
+    input.read(reinterpret_cast<char*>(result.data()), result.size());
     return result;
 }
 
@@ -0,0 +1,60 @@
+#ifndef MEMORY_BUFFER_HPP_INCLUDED
+#define MEMORY_BUFFER_HPP_INCLUDED
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+namespace git {
+
+/// Read only streambuf over a shared block of memory, the block is kept alive by the buffer.
+class shared_memory_buffer : public std::streambuf {
+    std::shared_ptr<const std::vector<char>> memory;
+
+    char* memory_begin() const {
+        // The get area is never written to.
+        return const_cast<char*>(memory->data());
+    }
+
+public:
+    explicit shared_memory_buffer(std::shared_ptr<const std::vector<char>> memory_) :
+        memory{std::move(memory_)}
+    {
+        setg(memory_begin(), memory_begin(), memory_begin() + memory->size());
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode witch) override {
+        if (!(witch & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        off_type base = dir == std::ios_base::beg ? 0 : dir == std::ios_base::end ? egptr() - eback() : gptr() - eback();
+        return seekpos(base + off, witch);
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode witch) override {
+        off_type offset = position;
+        if (!(witch & std::ios_base::in) || offset < 0 || offset > egptr() - eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + offset, egptr());
+        return position;
+    }
+};
+
+class shared_memory_istream : public std::istream {
+    shared_memory_buffer buffer;
+
+public:
+    explicit shared_memory_istream(std::shared_ptr<const std::vector<char>> memory) :
+        std::istream{nullptr},
+        buffer{std::move(memory)}
+    {
+        rdbuf(&buffer);
+    }
+};
+
+}
+
+#endif
@@ -49,6 +49,11 @@ public:
 
     virtual std::optional<size_t> size() const = 0;
 
+    /// Contiguous memory holding the device contents, nullptr if the device is not memory backed.
+    virtual const char* data() const {
+        return nullptr;
+    }
+
     virtual std::unique_ptr<std::streambuf> create_limited_buffer(size_t start, std::optional<size_t> length) = 0;
 
 protected:
@@ -127,6 +132,11 @@ public:
         return extent;
     }
 
+    const char* data() const override {
+        auto base = my_device->data();
+        return base ? base + start : nullptr;
+    }
+
     std::unique_ptr<std::streambuf> create_limited_buffer(size_t st, std::optional<size_t> length) override {
         if (!length) {
             length = extent;
@@ -3,11 +3,9 @@
 
 #include "sources.hpp"
 
-#include <iostream>
+#include "inflate_buffer.hpp"
 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/restrict.hpp>
+#include <iostream>
 
 namespace git {
 
@@ -19,20 +17,14 @@ public:
     using device_type = DEVICE_T;
 
     std::unique_ptr<std::streambuf> create_limited_buffer(size_t start, std::optional<size_t> length) override {
-        namespace io = boost::iostreams;
-
-        io::stream_offset sz = -1;
-        if (length) {
-            sz = *length;
-        }
-
-        std::stringstream uncompress_data;
-
-        auto out = std::make_unique<io::filtering_streambuf<io::input>>();
-        out->push(io::restrict(io::zlib_decompressor{}, start, sz));
-        out->push(*decompressed_source.create_buffer().release());
-
-        return out;
+        // The raw buffer keeps the compressed data alive, when it is mapped zlib reads it in place.
+        auto compressed_size = decompressed_source.size();
+        return std::make_unique<inflate_buffer>(
+            decompressed_source.create_buffer(),
+            compressed_size ? decompressed_source.data() : nullptr,
+            compressed_size.value_or(0),
+            start,
+            length);
     }
 
     uncompressed_device(device_type raw_source) :
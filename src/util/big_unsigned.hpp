@@ -14,6 +14,8 @@
 
 #include <boost/io/ios_state.hpp>
 
+#include "util/fixed_storage.hpp"
+
 namespace git {
 
 template <typename INT,
@@ -308,9 +310,19 @@ private:
 };
 
 static constexpr auto GIT_TYPE_ENCODE_BITS = 3;
-using big_unsigned            = big_unsigned_base<std::uint8_t>;
-using big_unsigned_with_type  = big_unsigned_base<std::uint8_t, GIT_TYPE_ENCODE_BITS, true>;
-using big_unsigned_big_endian = big_unsigned_base<std::uint8_t, 0, true>;
+
+/// Pack headers hold at most 64 bits, 7 per byte.
+static constexpr std::size_t GIT_HEADER_MAX_BYTES = 10;
+using header_storage = fixed_storage<std::uint8_t, GIT_HEADER_MAX_BYTES>;
+
+using big_unsigned            = big_unsigned_base<std::uint8_t, 0, false, header_storage>;
+using big_unsigned_with_type  = big_unsigned_base<std::uint8_t, GIT_TYPE_ENCODE_BITS, true, header_storage>;
+using big_unsigned_big_endian = big_unsigned_base<std::uint8_t, 0, true, header_storage>;
+
+// Arbitrary precision forms, stored on the heap.
+using unbounded_big_unsigned            = big_unsigned_base<std::uint8_t>;
+using unbounded_big_unsigned_with_type  = big_unsigned_base<std::uint8_t, GIT_TYPE_ENCODE_BITS, true>;
+using unbounded_big_unsigned_big_endian = big_unsigned_base<std::uint8_t, 0, true>;
 
 }
 
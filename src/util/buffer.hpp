@@ -2,6 +2,8 @@
 #define BUFFER_HPP_INCLUDED
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace git {
 namespace utils {
@@ -16,6 +18,17 @@ INT from_buffer(const BUFFER& buffer) {
     return result;
 }
 
+/// Reads a network order (big endian) integer directly from raw memory.
+template <class INT>
+INT from_netorder(const std::uint8_t* data) {
+    INT result = 0;
+    for (std::size_t i = 0; i < sizeof(INT); i++) {
+        result <<= 8;
+        result += data[i];
+    }
+    return result;
+}
+
 template <typename INT, class BUFFER=std::array<std::uint8_t, sizeof(INT)> >
 BUFFER to_buffer(INT value) {
     static constexpr auto MASK = (2 << sizeof(typename BUFFER::value_t) * 8) - 1;
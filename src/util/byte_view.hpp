@@ -0,0 +1,78 @@
+#ifndef BYTE_VIEW_HPP_INCLUDED
+#define BYTE_VIEW_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace git {
+
+/** Read only view of contiguous bytes that keeps its storage alive.
+ *
+ * The storage is shared, it can be a mapped file or a buffer owned by the view. Copies
+ * and sub-views are cheap.
+ */
+class byte_view {
+    std::shared_ptr<const void> owner;
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+
+public:
+    byte_view() = default;
+
+    /// View of [data, data + size), owner keeps that memory alive.
+    byte_view(std::shared_ptr<const void> owner_, const char* data, std::size_t size) :
+        owner{std::move(owner_)},
+        bytes{data},
+        length{size}
+    {}
+
+    explicit byte_view(std::shared_ptr<const std::vector<char>> content) :
+        bytes{content->data()},
+        length{content->size()}
+    {
+        owner = std::move(content);
+    }
+
+    /// Takes ownership of content.
+    explicit byte_view(std::vector<char>&& content) :
+        byte_view{std::make_shared<const std::vector<char>>(std::move(content))}
+    {}
+
+    const char* data() const {
+        return bytes;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    const char* begin() const {
+        return bytes;
+    }
+
+    const char* end() const {
+        return bytes + length;
+    }
+
+    char operator[](std::size_t offset) const {
+        return bytes[offset];
+    }
+
+    /// View of part of this one sharing the same storage.
+    byte_view subview(std::size_t offset, std::size_t count) const {
+        if (offset > length || count > length - offset) {
+            throw std::out_of_range("subview out of range");
+        }
+        return byte_view{owner, bytes + offset, count};
+    }
+};
+
+}
+
+#endif
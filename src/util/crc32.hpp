@@ -0,0 +1,161 @@
+#ifndef CRC32_HPP_INCLUDED
+#define CRC32_HPP_INCLUDED
+
+#include "util/kernel_dispatch.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <zlib.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GIT_CRC32_X86_CLMUL 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace git {
+
+namespace crc32_kernels {
+
+/// Updates a CRC32 over data, size must be a multiple of 16 and at least 64 for hardware kernels.
+using function = uint32_t (*)(uint32_t crc, const uint8_t* data, std::size_t size);
+
+/// Table driven CRC32 of zlib.
+inline uint32_t portable(uint32_t crc, const uint8_t* data, std::size_t size) {
+    return static_cast<uint32_t>(crc32_z(crc, data, size));
+}
+
+#ifdef GIT_CRC32_X86_CLMUL
+
+#define GIT_CRC32_TARGET __attribute__((target("pclmul,sse4.1")))
+
+/// Multiplies both halves of x by constants and adds next, folding x 128 bits further.
+GIT_CRC32_TARGET inline __m128i x86_fold(__m128i x, __m128i constants, __m128i next) {
+    auto low = _mm_clmulepi64_si128(x, constants, 0x00);
+    auto high = _mm_clmulepi64_si128(x, constants, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+/** CRC32 by folding with carry-less multiplications.
+ *
+ * Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction",
+ * with the bit reflected constants of the gzip polynomial: four 128 bit lanes are folded
+ * 64 bytes at a time, then into one lane, which is Barrett reduced to 32 bits.
+ */
+GIT_CRC32_TARGET inline uint32_t x86(uint32_t crc, const uint8_t* data, std::size_t size) {
+    const auto K1K2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const auto K3K4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const auto K5K0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const auto POLY = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const auto LOW_32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    auto load = [](const uint8_t* at) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+    };
+
+    // zlib inverts the CRC before and after, the kernel works on the raw register.
+    auto x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(~crc)));
+    auto x2 = load(data + 16);
+    auto x3 = load(data + 32);
+    auto x4 = load(data + 48);
+    data += 64;
+    size -= 64;
+
+    for (; size >= 64; data += 64, size -= 64) {
+        x1 = x86_fold(x1, K1K2, load(data));
+        x2 = x86_fold(x2, K1K2, load(data + 16));
+        x3 = x86_fold(x3, K1K2, load(data + 32));
+        x4 = x86_fold(x4, K1K2, load(data + 48));
+    }
+
+    x1 = x86_fold(x1, K3K4, x2);
+    x1 = x86_fold(x1, K3K4, x3);
+    x1 = x86_fold(x1, K3K4, x4);
+    for (; size >= 16; data += 16, size -= 16) {
+        x1 = x86_fold(x1, K3K4, load(data));
+    }
+
+    // 128 to 64 bits, then 64 to 32.
+    x2 = _mm_clmulepi64_si128(x1, K3K4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, LOW_32), K5K0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction.
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, LOW_32), POLY, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, LOW_32), POLY, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return ~static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#undef GIT_CRC32_TARGET
+
+inline bool x86_supported() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    auto pclmul = ecx & (1u << 1);
+    auto sse41 = ecx & (1u << 19);
+    return pclmul && sse41;
+}
+
+#endif
+
+/// Hardware kernel of this CPU, nullptr when there is none.
+inline function probe() {
+#ifdef GIT_CRC32_X86_CLMUL
+    return x86_supported() ? x86 : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+using dispatch = kernel_dispatch<function, portable, probe>;
+
+}
+
+/** CRC32 as zlib and the pack index compute it.
+ *
+ * Runs of at least MIN_FOLD_SIZE bytes are folded with carry-less multiplications when the
+ * CPU has them, the rest goes through zlib.
+ */
+class crc32_checksum {
+    uint32_t crc = 0;
+
+public:
+    static constexpr std::size_t MIN_FOLD_SIZE = 64;
+
+    /// True when long inputs go through the CPU carry-less multiplication.
+    static bool accelerated() {
+        return crc32_kernels::dispatch::accelerated();
+    }
+
+    /// Turns the folding kernel on or off for every instance, see kernel_dispatch::use_hardware().
+    static bool use_hardware(bool enable) {
+        return crc32_kernels::dispatch::use_hardware(enable);
+    }
+
+    crc32_checksum& update(const void* input, std::size_t size) {
+        auto data = static_cast<const uint8_t*>(input);
+        if (size >= MIN_FOLD_SIZE) {
+            auto folded = size & ~std::size_t{15};
+            crc = crc32_kernels::dispatch::selected().load(std::memory_order_relaxed)(crc, data, folded);
+            data += folded;
+            size -= folded;
+        }
+        crc = crc32_kernels::portable(crc, data, size);
+        return *this;
+    }
+
+    uint32_t value() const {
+        return crc;
+    }
+};
+
+}
+
+#endif
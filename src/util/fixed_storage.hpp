@@ -0,0 +1,127 @@
+#ifndef FIXED_STORAGE_HPP_INCLUDED
+#define FIXED_STORAGE_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+
+namespace git {
+
+/** Sequence of at most CAPACITY values stored inline.
+ *
+ * Has the subset of the std::vector interface big_unsigned_base uses, so it can be its
+ * storage without allocating. Going over the capacity throws std::overflow_error.
+ */
+template <typename T, std::size_t CAPACITY>
+class fixed_storage {
+    std::array<T, CAPACITY> values{};
+    std::size_t used = 0;
+
+    void check_room() const {
+        if (used == CAPACITY) {
+            throw std::overflow_error("fixed_storage capacity exceeded");
+        }
+    }
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_type capacity() {
+        return CAPACITY;
+    }
+
+    size_type size() const {
+        return used;
+    }
+
+    bool empty() const {
+        return used == 0;
+    }
+
+    void clear() {
+        used = 0;
+    }
+
+    void push_back(const T& value) {
+        check_room();
+        values[used++] = value;
+    }
+
+    iterator insert(const_iterator position, const T& value) {
+        check_room();
+        auto index = static_cast<size_type>(position - cbegin());
+        std::copy_backward(begin() + index, end(), end() + 1);
+        values[index] = value;
+        ++used;
+        return begin() + index;
+    }
+
+    reference front() {
+        return values[0];
+    }
+
+    const_reference front() const {
+        return values[0];
+    }
+
+    reference back() {
+        return values[used - 1];
+    }
+
+    const_reference back() const {
+        return values[used - 1];
+    }
+
+    iterator begin() {
+        return values.data();
+    }
+
+    iterator end() {
+        return values.data() + used;
+    }
+
+    const_iterator begin() const {
+        return values.data();
+    }
+
+    const_iterator end() const {
+        return values.data() + used;
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator crend() const {
+        return const_reverse_iterator(begin());
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef KERNEL_DISPATCH_HPP_INCLUDED
+#define KERNEL_DISPATCH_HPP_INCLUDED
+
+#include <atomic>
+
+namespace git {
+
+/** Runtime choice between a portable kernel and one using CPU specific instructions.
+ *
+ * PROBE returns the hardware kernel of this CPU, or nullptr, and is called once. The
+ * kernel in use is shared by every caller and can be switched with use_hardware().
+ */
+template <typename FUNCTION, FUNCTION PORTABLE, FUNCTION (*PROBE)()>
+class kernel_dispatch {
+public:
+    /// Hardware kernel of this CPU, nullptr when there is none.
+    static FUNCTION hardware() {
+        static const FUNCTION found = PROBE();
+        return found;
+    }
+
+    /// Kernel in use, chosen on first use.
+    static std::atomic<FUNCTION>& selected() {
+        static std::atomic<FUNCTION> current{hardware() ? hardware() : PORTABLE};
+        return current;
+    }
+
+    /// True when the hardware kernel is in use.
+    static bool accelerated() {
+        return selected().load() != PORTABLE;
+    }
+
+    /** Turns the hardware kernel on or off for every caller.
+     *
+     * Returns whether it is in use, which it can not be on CPUs without it.
+     */
+    static bool use_hardware(bool enable) {
+        auto found = hardware();
+        selected() = enable && found ? found : PORTABLE;
+        return accelerated();
+    }
+};
+
+}
+
+#endif
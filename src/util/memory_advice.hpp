@@ -0,0 +1,44 @@
+#ifndef MEMORY_ADVICE_HPP_INCLUDED
+#define MEMORY_ADVICE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace git {
+
+/// How a range of mapped memory is about to be read.
+enum class memory_advice {
+    normal,      ///< No particular order, the default.
+    sequential,  ///< In order, pages behind can be dropped early.
+    will_need    ///< Soon, start reading it in now.
+};
+
+/** Tells the kernel how a range of mapped memory will be read, with madvise().
+ *
+ * The range is widened to whole pages. This is only a hint: errors are ignored.
+ */
+inline void advise_memory(const void* data, std::size_t size, memory_advice advice) {
+    if (!data || size == 0) {
+        return;
+    }
+
+    static const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<uintptr_t>(data);
+    auto end = begin + size;
+    begin -= begin % page_size;
+
+    int flag = MADV_NORMAL;
+    if (advice == memory_advice::sequential) {
+        flag = MADV_SEQUENTIAL;
+    } else if (advice == memory_advice::will_need) {
+        flag = MADV_WILLNEED;
+    }
+    ::madvise(reinterpret_cast<void*>(begin), end - begin, flag);
+}
+
+}
+
+#endif
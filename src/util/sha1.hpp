@@ -0,0 +1,293 @@
+#ifndef SHA1_HPP_INCLUDED
+#define SHA1_HPP_INCLUDED
+
+#include "object_id.hpp"
+#include "util/kernel_dispatch.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GIT_SHA1_X86_SHA 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace git {
+
+namespace sha1_blocks {
+
+using function = void (*)(uint32_t* state, const uint8_t* data, std::size_t blocks);
+
+constexpr uint32_t rotate(uint32_t value, unsigned bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/// Plain C++ compression function, runs anywhere.
+inline void portable(uint32_t* state, const uint8_t* data, std::size_t blocks) {
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = uint32_t(data[4 * i]) << 24 | uint32_t(data[4 * i + 1]) << 16 |
+                   uint32_t(data[4 * i + 2]) << 8 | uint32_t(data[4 * i + 3]);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        auto round = [&](uint32_t f, uint32_t k, uint32_t word) {
+            uint32_t temp = rotate(a, 5) + f + e + k + word;
+            e = d;
+            d = c;
+            c = rotate(b, 30);
+            b = a;
+            a = temp;
+        };
+
+        for (int i = 0; i < 20; i++) { round((b & c) | (~b & d), 0x5a827999, w[i]); }
+        for (int i = 20; i < 40; i++) { round(b ^ c ^ d, 0x6ed9eba1, w[i]); }
+        for (int i = 40; i < 60; i++) { round((b & c) | (b & d) | (c & d), 0x8f1bbcdc, w[i]); }
+        for (int i = 60; i < 80; i++) { round(b ^ c ^ d, 0xca62c1d6, w[i]); }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef GIT_SHA1_X86_SHA
+
+#define GIT_SHA1_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+
+/// Four rounds with the x86 SHA extensions, FUNC selects the round function and constant.
+template <int FUNC>
+GIT_SHA1_TARGET inline void x86_rounds(__m128i& abcd, __m128i& previous, __m128i words) {
+    auto e = _mm_sha1nexte_epu32(previous, words);
+    previous = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e, FUNC);
+}
+
+/// Next four message words from the previous sixteen, which shift down by four.
+GIT_SHA1_TARGET inline void x86_schedule(__m128i& w0, __m128i& w1, __m128i& w2, __m128i& w3) {
+    auto next = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w0, w1), w2), w3);
+    w0 = w1;
+    w1 = w2;
+    w2 = w3;
+    w3 = next;
+}
+
+/// Four big endian message words.
+GIT_SHA1_TARGET inline __m128i x86_load(const uint8_t* words, __m128i byte_swap) {
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words)), byte_swap);
+}
+
+/// Compression function with the SHA-NI instructions, see x86_supported().
+GIT_SHA1_TARGET inline void x86(uint32_t* state, const uint8_t* data, std::size_t blocks) {
+    const auto BYTE_SWAP = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+    auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        auto saved_abcd = abcd;
+        auto saved_e0 = e0;
+
+        auto w0 = x86_load(data, BYTE_SWAP);
+        auto w1 = x86_load(data + 16, BYTE_SWAP);
+        auto w2 = x86_load(data + 32, BYTE_SWAP);
+        auto w3 = x86_load(data + 48, BYTE_SWAP);
+
+        auto previous = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, _mm_add_epi32(e0, w0), 0);
+        x86_rounds<0>(abcd, previous, w1);
+        x86_rounds<0>(abcd, previous, w2);
+        x86_rounds<0>(abcd, previous, w3);
+
+        x86_schedule(w0, w1, w2, w3);
+        x86_rounds<0>(abcd, previous, w3);
+        for (int i = 0; i < 5; i++) {
+            x86_schedule(w0, w1, w2, w3);
+            x86_rounds<1>(abcd, previous, w3);
+        }
+        for (int i = 0; i < 5; i++) {
+            x86_schedule(w0, w1, w2, w3);
+            x86_rounds<2>(abcd, previous, w3);
+        }
+        for (int i = 0; i < 5; i++) {
+            x86_schedule(w0, w1, w2, w3);
+            x86_rounds<3>(abcd, previous, w3);
+        }
+
+        e0 = _mm_sha1nexte_epu32(previous, saved_e0);
+        abcd = _mm_add_epi32(abcd, saved_abcd);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+#undef GIT_SHA1_TARGET
+
+inline bool x86_supported() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    auto ssse3 = ecx & (1u << 9);
+    auto sse41 = ecx & (1u << 19);
+    if (!ssse3 || !sse41 || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return ebx & (1u << 29);
+}
+
+#else
+
+inline bool x86_supported() {
+    return false;
+}
+
+#endif
+
+/// Hardware compression function of this CPU, nullptr when there is none.
+inline function probe() {
+#ifdef GIT_SHA1_X86_SHA
+    return x86_supported() ? x86 : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+using dispatch = kernel_dispatch<function, portable, probe>;
+
+/// Compresses with the kernel dispatch selected.
+struct dispatched {
+    void operator()(uint32_t* state, const uint8_t* data, std::size_t blocks) const {
+        dispatch::selected().load(std::memory_order_relaxed)(state, data, blocks);
+    }
+};
+
+}
+
+/** Incremental SHA-1 over a compression function.
+ *
+ * COMPRESSION(state, data, blocks) compresses whole 64 byte blocks into the state, this
+ * buffers what is in between.
+ */
+template <typename COMPRESSION>
+class basic_sha1 {
+public:
+    static constexpr std::size_t BLOCK_SIZE = 64;
+
+private:
+    std::array<uint32_t, 5> state;
+    std::array<uint8_t, BLOCK_SIZE> block;
+    std::size_t block_used = 0;
+    uint64_t total = 0;
+
+    void process(const uint8_t* data, std::size_t blocks) {
+        compression(state.data(), data, blocks);
+    }
+
+protected:
+    COMPRESSION compression;
+
+public:
+    basic_sha1() {
+        reset();
+    }
+
+    void reset() {
+        state = {{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 }};
+        block_used = 0;
+        total = 0;
+        compression = COMPRESSION{};
+    }
+
+    basic_sha1& update(const void* input, std::size_t size) {
+        auto data = static_cast<const uint8_t*>(input);
+        total += size;
+
+        if (block_used > 0) {
+            auto count = std::min(size, BLOCK_SIZE - block_used);
+            std::memcpy(block.data() + block_used, data, count);
+            block_used += count;
+            data += count;
+            size -= count;
+            if (block_used < BLOCK_SIZE) {
+                return *this;
+            }
+            process(block.data(), 1);
+            block_used = 0;
+        }
+
+        auto blocks = size / BLOCK_SIZE;
+        if (blocks > 0) {
+            process(data, blocks);
+            data += blocks * BLOCK_SIZE;
+            size -= blocks * BLOCK_SIZE;
+        }
+
+        std::memcpy(block.data(), data, size);
+        block_used = size;
+        return *this;
+    }
+
+    basic_sha1& update(const std::string& input) {
+        return update(input.data(), input.size());
+    }
+
+    /// Completes the digest, the instance has to be reset before reuse.
+    object_id finish() {
+        uint64_t bits = total * 8;
+
+        static const uint8_t padding[BLOCK_SIZE] = { 0x80 };
+        auto pad = (block_used < 56 ? 56 : 120) - block_used;
+        update(padding, pad);
+
+        uint8_t length[8];
+        for (int i = 7; i >= 0; i--) {
+            length[i] = static_cast<uint8_t>(bits & 0xff);
+            bits >>= 8;
+        }
+        update(length, sizeof(length));
+
+        uint8_t digest[OBJECT_NAME_SIZE];
+        for (std::size_t i = 0; i < state.size(); i++) {
+            digest[4 * i]     = static_cast<uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+        return object_id{digest};
+    }
+};
+
+/** Incremental SHA-1.
+ *
+ * Used for pack and index checksums. Blocks go through the SHA extensions of the CPU when
+ * it has them, the portable code otherwise.
+ */
+class sha1 : public basic_sha1<sha1_blocks::dispatched> {
+public:
+    /// True when blocks are hashed by the CPU SHA instructions.
+    static bool accelerated() {
+        return sha1_blocks::dispatch::accelerated();
+    }
+
+    /// Turns the SHA instructions on or off for every instance, see kernel_dispatch::use_hardware().
+    static bool use_hardware(bool enable) {
+        return sha1_blocks::dispatch::use_hardware(enable);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef SHA1DC_HPP_INCLUDED
+#define SHA1DC_HPP_INCLUDED
+
+#include "util/sha1.hpp"
+#include "object_id.hpp"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace git {
+
+/// Thrown when hashed data holds a block of a SHA-1 collision attack.
+class sha1_collision_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/** Detection of SHA-1 collision attacks, as git does with SHA-1DC.
+ *
+ * Every known attack, SHAttered included, builds its near-collision blocks on one of a few
+ * disturbance vectors (Stevens, "Counter-cryptanalysis", CRYPTO 2013). For each vector the
+ * block that would pair with the one hashed is rebuilt from the internal state at a step
+ * where both share it, and hashed from there. When it gives the same output the block is
+ * half of a collision.
+ *
+ * Like git, a block is only tested against the vectors whose unavoidable message bit conditions
+ * it meets, which rules out every vector for nearly all blocks.
+ */
+namespace sha1_collision {
+
+constexpr std::size_t STEPS = 80;
+
+using sha1_blocks::rotate;
+
+/// A disturbance vector, with the message differences of its local collisions.
+struct disturbance_vector {
+    unsigned type;       ///< I or II, how its window of 16 words is disturbed.
+    unsigned k;          ///< Step where that window starts.
+    unsigned b;          ///< Bit disturbed.
+    unsigned test_step;  ///< Both blocks have the same state before this step.
+    std::array<uint32_t, STEPS> dm;
+};
+
+/** Builds vector type(k, b).
+ *
+ * The window holds bit b at step k + 15, for type II also bit b - 1 at steps k + 1 and k + 3.
+ * It is expanded both ways with the message recurrence. Each disturbance is then corrected
+ * over the next five steps, which gives the message differences.
+ */
+inline disturbance_vector make_disturbance_vector(unsigned type, unsigned k, unsigned b) {
+    constexpr int BEFORE = 5;
+    std::array<uint32_t, STEPS + BEFORE> vector{};
+    auto at = [&vector](int step) -> uint32_t& {
+        return vector[step + BEFORE];
+    };
+
+    int first = static_cast<int>(k);
+    at(first + 15) = uint32_t{1} << b;
+    if (type == 2) {
+        at(first + 1) = at(first + 3) = rotate(uint32_t{1} << b, 31);
+    }
+    for (int step = first + 16; step < static_cast<int>(STEPS); step++) {
+        at(step) = rotate(at(step - 3) ^ at(step - 8) ^ at(step - 14) ^ at(step - 16), 1);
+    }
+    for (int step = first - 1; step >= -BEFORE; step--) {
+        at(step) = rotate(at(step + 16), 31) ^ at(step + 13) ^ at(step + 8) ^ at(step + 2);
+    }
+
+    disturbance_vector result{type, k, b, k < 50 ? 58u : 65u, {}};
+    for (int step = 0; step < static_cast<int>(STEPS); step++) {
+        result.dm[step] = at(step) ^ rotate(at(step - 1), 5) ^ at(step - 2) ^
+            rotate(at(step - 3), 30) ^ rotate(at(step - 4), 30) ^ rotate(at(step - 5), 30);
+    }
+    return result;
+}
+
+/// The 32 vectors SHA-1DC checks: I(43..52, b) and II(45..56, b).
+inline const std::vector<disturbance_vector>& disturbance_vectors() {
+    static const std::vector<disturbance_vector> vectors = []() {
+        static const unsigned DEFINITIONS[][3] = {
+            {1, 43, 0}, {1, 44, 0}, {1, 45, 0}, {1, 46, 0}, {1, 46, 2}, {1, 47, 0}, {1, 47, 2},
+            {1, 48, 0}, {1, 48, 2}, {1, 49, 0}, {1, 49, 2}, {1, 50, 0}, {1, 50, 2}, {1, 51, 0},
+            {1, 51, 2}, {1, 52, 0},
+            {2, 45, 0}, {2, 46, 0}, {2, 46, 2}, {2, 47, 0}, {2, 48, 0}, {2, 49, 0}, {2, 49, 2},
+            {2, 50, 0}, {2, 50, 2}, {2, 51, 0}, {2, 51, 2}, {2, 52, 0}, {2, 53, 0}, {2, 54, 0},
+            {2, 55, 0}, {2, 56, 0}
+        };
+        std::vector<disturbance_vector> result;
+        for (const auto& definition: DEFINITIONS) {
+            result.push_back(make_disturbance_vector(definition[0], definition[1], definition[2]));
+        }
+        return result;
+    }();
+    return vectors;
+}
+
+/** Condition on two bits of the expanded message: bit of w[step] equals, or with differ is not,
+ * bit of w[other_step].
+ *
+ * A collision built on a vector must meet it, vectors holds the bit of each such vector.
+ */
+struct bit_condition {
+    uint8_t step;
+    uint8_t bit;
+    uint8_t other_step;
+    uint8_t other_bit;
+    bool differ;
+    uint32_t vectors;
+};
+
+/** The unavoidable bit conditions of SHA-1DC, with bit i standing for disturbance_vectors()[i].
+ *
+ * Those that rule out the most vectors come first.
+ */
+inline const std::vector<bit_condition>& unavoidable_conditions() {
+    static const std::vector<bit_condition> conditions = {
+        {44, 29, 45, 29, false, 0x0283a080}, {40, 29, 41, 29, false, 0x800a00a2}, {43, 29, 44, 29, false, 0x00a12820},
+        {45, 29, 46, 29, false, 0x0a0a8200}, {46, 29, 47, 29, false, 0x18180801}, {47, 29, 48, 29, false, 0x30302002},
+        {48, 29, 49, 29, false, 0x60a08004}, {49, 29, 50, 29, false, 0xc2810008}, {41, 4, 44, 29, false, 0x00812025},
+        {42, 4, 45, 29, false, 0x0202808a}, {43, 4, 46, 29, false, 0x08080225}, {44, 4, 47, 29, false, 0x1010088a},
+        {45, 4, 48, 29, false, 0x20202224}, {46, 4, 49, 29, false, 0x40808888}, {47, 4, 50, 29, false, 0x82012220},
+        {41, 29, 42, 29, false, 0x00180284}, {42, 29, 43, 29, false, 0x00300a08}, {50, 29, 51, 29, false, 0x8a020020},
+        {52, 29, 53, 29, false, 0x30110200}, {53, 29, 54, 29, false, 0x60220800}, {54, 29, 55, 29, false, 0xc0882000},
+        {37, 4, 40, 29, false, 0x50020021}, {38, 4, 41, 29, false, 0xa0080082}, {39, 4, 42, 29, false, 0x40100205},
+        {40, 4, 43, 29, false, 0x8020080a}, {48, 4, 51, 29, false, 0x08028880}, {49, 4, 52, 29, false, 0x10092200},
+        {50, 4, 53, 29, false, 0x20128800}, {51, 29, 52, 29, false, 0x18080080}, {55, 29, 56, 29, false, 0x82108000},
+        {51, 4, 54, 29, false, 0x40282000}, {52, 4, 55, 29, false, 0x80908000}, {36, 4, 40, 29, false, 0x00110208},
+        {36, 1, 37, 6, true, 0x00041040}, {39, 1, 40, 6, true, 0x00401010}, {39, 4, 40, 29, true, 0x50000001},
+        {40, 1, 41, 6, true, 0x01004040}, {40, 4, 41, 29, true, 0xa0000002}, {41, 1, 42, 6, true, 0x04040100},
+        {41, 4, 42, 29, true, 0x40000005}, {42, 4, 43, 29, true, 0x8000000a}, {43, 4, 44, 29, true, 0x00000025},
+        {44, 4, 45, 29, true, 0x0000008a}, {45, 4, 46, 29, true, 0x00000224}, {46, 4, 47, 29, true, 0x00000888},
+        {47, 4, 48, 29, true, 0x00002220}, {48, 4, 49, 29, true, 0x00008880}, {49, 4, 50, 29, true, 0x00012200},
+        {50, 4, 51, 29, true, 0x00028800}, {44, 6, 46, 6, false, 0x00001110}, {45, 6, 47, 6, false, 0x00004440},
+        {52, 29, 55, 29, true, 0x00182000}, {35, 4, 39, 29, false, 0x00080084}, {35, 1, 36, 6, true, 0x00000410},
+        {37, 1, 38, 6, true, 0x00004100}, {40, 6, 41, 1, false, 0x00401000}, {41, 6, 42, 1, false, 0x01004000},
+        {42, 6, 43, 1, false, 0x04040000}, {44, 1, 45, 6, true, 0x00404000}, {46, 6, 47, 1, false, 0x01000010},
+        {47, 6, 48, 1, false, 0x04000040}, {50, 6, 51, 1, false, 0x00041000}, {56, 29, 57, 29, false, 0x08200000},
+        {57, 29, 58, 29, false, 0x10800000}, {58, 29, 59, 29, false, 0x22000000}, {60, 0, 61, 5, true, 0x00010004},
+        {61, 0, 62, 5, true, 0x00020008}, {61, 2, 62, 7, true, 0x00040010}, {62, 0, 63, 5, true, 0x00080020},
+        {63, 0, 64, 5, true, 0x00100080}, {63, 1, 64, 6, true, 0x00010004}, {36, 4, 38, 4, true, 0x28000000},
+        {42, 6, 44, 6, false, 0x00000110}, {43, 6, 45, 6, false, 0x00000440}, {46, 6, 48, 6, false, 0x00001100},
+        {47, 6, 49, 6, false, 0x00004400}, {48, 6, 50, 6, false, 0x00041000}, {53, 4, 56, 29, false, 0x02200000},
+        {53, 29, 56, 29, true, 0x00308000}, {54, 4, 57, 29, false, 0x08800000}, {55, 4, 58, 29, false, 0x12000000},
+        {55, 29, 58, 29, true, 0x02800000}, {56, 4, 59, 29, false, 0x28000000}, {35, 3, 39, 28, false, 0x00082000},
+        {37, 4, 41, 29, false, 0x00220820}, {38, 4, 42, 29, false, 0x00882080}, {39, 4, 43, 29, false, 0x02108200},
+        {37, 1, 37, 6, false, 0x00004000}, {56, 4, 56, 29, true, 0x08000000}, {57, 4, 57, 29, true, 0x10000000},
+        {35, 30, 36, 3, true, 0x00100000}, {36, 0, 37, 5, true, 0x00400000}, {36, 4, 37, 4, true, 0x00000800},
+        {36, 30, 37, 3, true, 0x00200000}, {37, 0, 38, 5, true, 0x01000000}, {37, 4, 38, 4, true, 0x00002000},
+        {37, 30, 38, 3, true, 0x00800000}, {38, 0, 39, 5, true, 0x04000000}, {38, 1, 39, 6, true, 0x00000400},
+        {38, 4, 39, 4, true, 0x00008000}, {38, 30, 39, 3, true, 0x02000000}, {39, 6, 40, 1, false, 0x00000400},
+        {39, 30, 40, 3, true, 0x08000000}, {42, 1, 43, 6, true, 0x00000400}, {43, 1, 44, 6, true, 0x00001000},
+        {45, 1, 46, 6, true, 0x01000000}, {45, 6, 46, 1, false, 0x00400000}, {46, 1, 47, 6, true, 0x04000000},
+        {47, 1, 48, 6, true, 0x00040000}, {48, 6, 49, 1, false, 0x00000100}, {49, 6, 50, 1, false, 0x00000400},
+        {50, 1, 51, 6, true, 0x00400000}, {51, 1, 52, 6, true, 0x01000000}, {51, 6, 52, 1, false, 0x00004000},
+        {52, 1, 53, 6, true, 0x04000000}, {53, 6, 54, 1, false, 0x00400000}, {54, 6, 55, 1, false, 0x01000000},
+        {55, 6, 56, 1, false, 0x04000000}, {58, 0, 59, 5, true, 0x00000001}, {59, 0, 60, 5, true, 0x00000002},
+        {59, 29, 60, 29, false, 0x08000000}, {61, 1, 62, 6, true, 0x00000001}, {62, 1, 63, 6, true, 0x00000002},
+        {62, 2, 63, 7, true, 0x00000040}, {63, 2, 64, 7, true, 0x00000100}, {40, 6, 42, 6, false, 0x00000010},
+        {41, 6, 43, 6, false, 0x00000040}, {49, 6, 51, 6, false, 0x00004000}, {51, 6, 53, 6, false, 0x00400000},
+        {52, 6, 54, 6, false, 0x01000000}, {53, 6, 55, 6, false, 0x04000000}, {57, 4, 59, 29, false, 0x40000000},
+        {58, 29, 61, 29, true, 0x10000000}, {35, 5, 39, 30, false, 0x00004000}, {36, 3, 40, 28, false, 0x00100000},
+        {37, 3, 41, 28, false, 0x00200000}, {37, 5, 41, 30, false, 0x00400000}, {38, 3, 42, 28, false, 0x00800000},
+        {38, 5, 42, 30, false, 0x01000000}, {39, 3, 43, 28, false, 0x02000000}, {39, 5, 43, 30, false, 0x04000000},
+        {40, 3, 44, 28, false, 0x08000000}, {40, 4, 44, 29, false, 0x08200800}, {41, 3, 45, 28, false, 0x10000000},
+        {41, 4, 45, 29, false, 0x10812000}, {42, 3, 46, 28, false, 0x20000000}, {42, 4, 46, 29, false, 0x22028000},
+        {43, 3, 47, 28, false, 0x40000000}, {43, 4, 47, 29, false, 0x48080001}, {44, 3, 48, 28, false, 0x80000000},
+        {44, 4, 48, 29, false, 0x90100002}, {58, 4, 62, 29, false, 0x20000000}, {59, 4, 63, 29, false, 0x40000000},
+        {59, 5, 63, 30, false, 0x00000001}, {60, 4, 64, 29, false, 0x80000000}, {60, 5, 64, 30, false, 0x00000002}
+    };
+    return conditions;
+}
+
+/// Vectors whose unavoidable conditions the expanded message w meets, one bit each.
+inline uint32_t possible_vectors(const uint32_t* w) {
+    uint32_t possible = ~uint32_t{0};
+    for (const auto& condition: unavoidable_conditions()) {
+        if (possible == 0) {
+            break;
+        }
+        if (((w[condition.step] >> condition.bit ^ w[condition.other_step] >> condition.other_bit) & 1) != condition.differ) {
+            possible &= ~condition.vectors;
+        }
+    }
+    return possible;
+}
+
+/// Expands the 64 bytes at data to the message words of the 80 steps.
+inline void expand_message(const uint8_t* data, uint32_t* w) {
+    for (int i = 0; i < 16; i++) {
+        w[i] = uint32_t(data[4 * i]) << 24 | uint32_t(data[4 * i + 1]) << 16 |
+               uint32_t(data[4 * i + 2]) << 8 | uint32_t(data[4 * i + 3]);
+    }
+    for (std::size_t i = 16; i < STEPS; i++) {
+        w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+}
+
+/// Round function and constant of step.
+inline uint32_t round_function(std::size_t step, uint32_t b, uint32_t c, uint32_t d) {
+    if (step < 20) {
+        return ((b & c) | (~b & d)) + 0x5a827999;
+    }
+    if (step < 40) {
+        return (b ^ c ^ d) + 0x6ed9eba1;
+    }
+    if (step < 60) {
+        return ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+    }
+    return (b ^ c ^ d) + 0xca62c1d6;
+}
+
+/// Working variables of the compression function.
+struct state {
+    uint32_t a, b, c, d, e;
+};
+
+/// A block compressed, with the expanded message and the states the vectors are tested from.
+struct compressed_block {
+    uint32_t w[STEPS];
+    state before_58;
+    state before_65;
+
+    /// Compresses the 64 bytes at data into ihv.
+    compressed_block(uint32_t* ihv, const uint8_t* data) {
+        expand_message(data, w);
+
+        state current{ihv[0], ihv[1], ihv[2], ihv[3], ihv[4]};
+        for (std::size_t step = 0; step < STEPS; step++) {
+            if (step == 58) {
+                before_58 = current;
+            } else if (step == 65) {
+                before_65 = current;
+            }
+            auto next_a = rotate(current.a, 5) + round_function(step, current.b, current.c, current.d) + current.e + w[step];
+            current.e = current.d;
+            current.d = current.c;
+            current.c = rotate(current.b, 30);
+            current.b = current.a;
+            current.a = next_a;
+        }
+
+        ihv[0] += current.a;
+        ihv[1] += current.b;
+        ihv[2] += current.c;
+        ihv[3] += current.d;
+        ihv[4] += current.e;
+    }
+};
+
+/** Tests a block that gave the chaining value ihv_out against one vector.
+ *
+ * The other block is run from the state before the test step back to its own input, then
+ * forward to its output. True when that output is ihv_out.
+ */
+inline bool test(const disturbance_vector& vector, const compressed_block& block, const uint32_t* ihv_out) {
+    const auto& before = vector.test_step == 58 ? block.before_58 : block.before_65;
+    const auto* w = block.w;
+
+    auto a = before.a, b = before.b, c = before.c, d = before.d, e = before.e;
+    for (auto step = vector.test_step; step-- > 0;) {
+        auto previous_b = rotate(c, 2);
+        auto previous_e = a - rotate(b, 5) - round_function(step, previous_b, d, e) - (w[step] ^ vector.dm[step]);
+        a = b;
+        b = previous_b;
+        c = d;
+        d = e;
+        e = previous_e;
+    }
+    uint32_t in[5] = { a, b, c, d, e };
+
+    a = before.a, b = before.b, c = before.c, d = before.d, e = before.e;
+    for (auto step = vector.test_step; step < STEPS; step++) {
+        auto next_a = rotate(a, 5) + round_function(step, b, c, d) + e + (w[step] ^ vector.dm[step]);
+        e = d;
+        d = c;
+        c = rotate(b, 30);
+        b = a;
+        a = next_a;
+    }
+
+    return in[0] + a == ihv_out[0] && in[1] + b == ihv_out[1] && in[2] + c == ihv_out[2] &&
+        in[3] + d == ihv_out[3] && in[4] + e == ihv_out[4];
+}
+
+/// Compresses one block into ihv, true when it is half of a collision on any of vectors.
+inline bool compress(uint32_t* ihv, const uint8_t* data, const std::vector<disturbance_vector>& vectors) {
+    compressed_block block(ihv, data);
+    for (const auto& vector: vectors) {
+        if (test(vector, block, ihv)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Compresses one block into ihv, true when it is half of a collision.
+ *
+ * Only the vectors whose unavoidable conditions the block meets are tested. Most blocks
+ * meet none and are compressed by the sha1 kernel in use.
+ */
+inline bool compress(uint32_t* ihv, const uint8_t* data) {
+    uint32_t w[STEPS];
+    expand_message(data, w);
+    auto possible = possible_vectors(w);
+    if (possible == 0) {
+        sha1_blocks::dispatched{}(ihv, data, 1);
+        return false;
+    }
+
+    compressed_block block(ihv, data);
+    const auto& vectors = disturbance_vectors();
+    for (std::size_t i = 0; possible != 0; i++, possible >>= 1) {
+        if ((possible & 1) && test(vectors[i], block, ihv)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Compression function for basic_sha1 that remembers whether some block was half of a collision.
+class detecting_compression {
+    bool detected = false;
+
+public:
+    void operator()(uint32_t* ihv, const uint8_t* data, std::size_t blocks) {
+        for (; blocks > 0; blocks--, data += 64) {
+            detected |= compress(ihv, data);
+        }
+    }
+
+    bool collision_detected() const {
+        return detected;
+    }
+};
+
+}
+
+/** Incremental SHA-1 that detects collision attacks, see sha1_collision.
+ *
+ * Gives the same digest as sha1, only slower as each block is checked. Used to name
+ * objects, like git does.
+ */
+class sha1dc : public basic_sha1<sha1_collision::detecting_compression> {
+public:
+    /// True when some block hashed so far is half of a collision.
+    bool collision_detected() const {
+        return compression.collision_detected();
+    }
+};
+
+/// Starts the name of an object: hashes the "<type> <size>\0" header git puts before its content.
+inline void hash_object_header(sha1dc& hash, const std::string& type, uint64_t size) {
+    auto header = type + " " + std::to_string(size);
+    hash.update(header.c_str(), header.size() + 1);
+}
+
+/// Completes the name of an object, throws sha1_collision_error for a collision attack.
+inline object_id finish_object_name(sha1dc& hash) {
+    auto name = hash.finish();
+    if (hash.collision_detected()) {
+        throw sha1_collision_error("SHA-1 appears to be part of a collision attack: " + name.to_string());
+    }
+    return name;
+}
+
+/// Name git gives to an object of this type (e.g. "blob") and content, see finish_object_name().
+inline object_id hash_object(const std::string& type, const void* data, std::size_t size) {
+    sha1dc hash;
+    hash_object_header(hash, type, size);
+    hash.update(data, size);
+    return finish_object_name(hash);
+}
+
+}
+
+#endif
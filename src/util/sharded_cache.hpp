@@ -0,0 +1,64 @@
+#ifndef SHARDED_CACHE_HPP_INCLUDED
+#define SHARDED_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace git {
+
+/** Map of owned values that many threads can use at once.
+ *
+ * Keys are spread over SHARDS maps, each with its own lock, so concurrent lookups rarely
+ * wait on each other. Values are never removed while the cache lives, references to them
+ * stay valid.
+ */
+template <typename KEY, typename VALUE, std::size_t SHARDS = 16, typename HASH = std::hash<KEY>>
+class sharded_cache {
+    struct shard {
+        std::mutex lock;
+        std::unordered_map<KEY, std::unique_ptr<VALUE>, HASH> values;
+    };
+
+    // Shards hold locks, they are kept on the heap so the cache can be moved.
+    std::unique_ptr<shard[]> shards = std::make_unique<shard[]>(SHARDS);
+
+    shard& shard_for(const KEY& key) const {
+        return shards[HASH{}(key) % SHARDS];
+    }
+
+public:
+    /// The value cached for key, nullptr when there is none.
+    VALUE* find(const KEY& key) const {
+        auto& owner = shard_for(key);
+        std::lock_guard<std::mutex> guard{owner.lock};
+        auto found = owner.values.find(key);
+        return found == owner.values.end() ? nullptr : found->second.get();
+    }
+
+    /** Caches value for key.
+     *
+     * When another thread cached a value for key first that one is kept and returned,
+     * value is discarded.
+     */
+    VALUE& insert(const KEY& key, std::unique_ptr<VALUE> value) {
+        auto& owner = shard_for(key);
+        std::lock_guard<std::mutex> guard{owner.lock};
+        return *owner.values.emplace(key, std::move(value)).first->second;
+    }
+
+    std::size_t size() const {
+        std::size_t result = 0;
+        for (std::size_t i = 0; i < SHARDS; i++) {
+            std::lock_guard<std::mutex> guard{shards[i].lock};
+            result += shards[i].values.size();
+        }
+        return result;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef WORK_STEALING_HPP_INCLUDED
+#define WORK_STEALING_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace git {
+
+/** Runs tasks, that can push more tasks, over a fixed number of threads.
+ *
+ * Each thread has its own queue and works on its newest task first, which keeps related
+ * work together and bounds how many tasks are waiting. Idle threads steal the oldest task
+ * of another queue. run() returns once every task ran, or rethrows the first exception a
+ * task raised after the threads stopped.
+ */
+template <typename TASK>
+class work_stealing_scheduler {
+    struct queue {
+        std::mutex lock;
+        std::deque<TASK> tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues;
+    std::atomic<std::size_t> pending{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex idle_lock;
+    std::condition_variable idle;
+
+    std::optional<TASK> pop(std::size_t worker) {
+        {
+            auto& own = *queues[worker];
+            std::lock_guard<std::mutex> guard{own.lock};
+            if (!own.tasks.empty()) {
+                auto task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            auto& other = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> guard{other.lock};
+            if (!other.tasks.empty()) {
+                auto task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void finish_task() {
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> guard{idle_lock};
+            idle.notify_all();
+        }
+    }
+
+    template <typename RUN>
+    void work(std::size_t worker, RUN& run) {
+        while (!failed && pending > 0) {
+            auto task = pop(worker);
+            if (!task) {
+                std::unique_lock<std::mutex> guard{idle_lock};
+                idle.wait_for(guard, std::chrono::milliseconds(1));
+                continue;
+            }
+
+            try {
+                run(worker, *task);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard{idle_lock};
+                if (!failed.exchange(true)) {
+                    error = std::current_exception();
+                }
+                idle.notify_all();
+            }
+            finish_task();
+        }
+    }
+
+public:
+    explicit work_stealing_scheduler(std::size_t threads = std::thread::hardware_concurrency()) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (std::size_t i = 0; i < threads; i++) {
+            queues.push_back(std::make_unique<queue>());
+        }
+    }
+
+    std::size_t thread_count() const {
+        return queues.size();
+    }
+
+    /// Queues a task on the queue of a worker, tasks can push from within run().
+    void push(std::size_t worker, TASK task) {
+        ++pending;
+        {
+            auto& target = *queues[worker % queues.size()];
+            std::lock_guard<std::mutex> guard{target.lock};
+            target.tasks.push_back(std::move(task));
+        }
+        idle.notify_one();
+    }
+
+    /// Runs every queued task, run(worker, task) is called from the worker threads.
+    template <typename RUN>
+    void run(RUN run) {
+        std::vector<std::thread> threads;
+        for (std::size_t worker = 1; worker < queues.size(); worker++) {
+            threads.emplace_back([this, worker, &run]() {
+                work(worker, run);
+            });
+        }
+        work(0, run);
+        for (auto& thread: threads) {
+            thread.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+}
+
+#endif
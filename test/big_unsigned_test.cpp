@@ -23,7 +23,10 @@ namespace snowhouse {
     };
 }
 
-void big_unsigned_test() {
+namespace {
+
+template <typename BIG_UNSIGNED, typename BIG_UNSIGNED_BIG_ENDIAN, typename BIG_UNSIGNED_WITH_TYPE>
+void big_unsigned_suite(const std::string& storage_name) {
     const static std::uint8_t num_10[] = {
         0x0a, 0x01
     };
@@ -84,7 +87,7 @@ void big_unsigned_test() {
         0x8f, 0xde, 0xf9, 0xea, 0xc4, 0xe7, 0x8a, 0x8d, 0x09
     };
 
-    describe("big_unsigned tests", [&]() {
+    describe(("big_unsigned tests, " + storage_name).c_str(), [&]() {
 
         std::stringstream stream;
         before_each([&]() {
@@ -139,56 +142,56 @@ void big_unsigned_test() {
             });
         };
 
-        runTests(num_10,      uint8_t (10),    "0xa",     big_unsigned_big_endian{10});
-        runTests(num_32,      uint8_t (32),    "0x20",    big_unsigned_big_endian{32});
-        runTests(num_255_BE,  uint8_t (255),   "0xff",    big_unsigned_big_endian{255});
-        runTests(num_1025_BE, uint16_t(1025),  "0x401",   big_unsigned_big_endian{1025});
-        runTests(num_65536_BE,uint32_t(65536), "0x10000", big_unsigned_big_endian{65536});
+        runTests(num_10,      uint8_t (10),    "0xa",     BIG_UNSIGNED_BIG_ENDIAN{10});
+        runTests(num_32,      uint8_t (32),    "0x20",    BIG_UNSIGNED_BIG_ENDIAN{32});
+        runTests(num_255_BE,  uint8_t (255),   "0xff",    BIG_UNSIGNED_BIG_ENDIAN{255});
+        runTests(num_1025_BE, uint16_t(1025),  "0x401",   BIG_UNSIGNED_BIG_ENDIAN{1025});
+        runTests(num_65536_BE,uint32_t(65536), "0x10000", BIG_UNSIGNED_BIG_ENDIAN{65536});
 
-        runTests(num_10,      uint64_t(10),    "0xa",     big_unsigned_big_endian{10});
-        runTests(num_32,      uint64_t(32),    "0x20",    big_unsigned_big_endian{32});
-        runTests(num_255_BE,  uint64_t(255),   "0xff",    big_unsigned_big_endian{255});
-        runTests(num_1025_BE, uint64_t(1025),  "0x401",   big_unsigned_big_endian{1025});
-        runTests(num_65536_BE,uint64_t(65536), "0x10000", big_unsigned_big_endian{65536});
+        runTests(num_10,      uint64_t(10),    "0xa",     BIG_UNSIGNED_BIG_ENDIAN{10});
+        runTests(num_32,      uint64_t(32),    "0x20",    BIG_UNSIGNED_BIG_ENDIAN{32});
+        runTests(num_255_BE,  uint64_t(255),   "0xff",    BIG_UNSIGNED_BIG_ENDIAN{255});
+        runTests(num_1025_BE, uint64_t(1025),  "0x401",   BIG_UNSIGNED_BIG_ENDIAN{1025});
+        runTests(num_65536_BE,uint64_t(65536), "0x10000", BIG_UNSIGNED_BIG_ENDIAN{65536});
 
         runTests(                 num_0x123456789abcdef_BE,
                              uint64_t(0x123456789abcdef),
                                      "0x123456789abcdef",
-                 big_unsigned_big_endian{0x123456789abcdef});
+                 BIG_UNSIGNED_BIG_ENDIAN{0x123456789abcdef});
 
-        runTests(num_10,   uint8_t(10),     "0xa",     big_unsigned{10});
-        runTests(num_32,   uint8_t(32),     "0x20",    big_unsigned{32});
-        runTests(num_255,  uint8_t(255),    "0xff",    big_unsigned{255});
-        runTests(num_1025, uint16_t(1025),  "0x401",   big_unsigned{1025});
-        runTests(num_65536,uint32_t(65536), "0x10000", big_unsigned{65536});
+        runTests(num_10,   uint8_t(10),     "0xa",     BIG_UNSIGNED{10});
+        runTests(num_32,   uint8_t(32),     "0x20",    BIG_UNSIGNED{32});
+        runTests(num_255,  uint8_t(255),    "0xff",    BIG_UNSIGNED{255});
+        runTests(num_1025, uint16_t(1025),  "0x401",   BIG_UNSIGNED{1025});
+        runTests(num_65536,uint32_t(65536), "0x10000", BIG_UNSIGNED{65536});
 
-        runTests(num_10,   uint64_t(10),    "0xa",     big_unsigned{10});
-        runTests(num_32,   uint64_t(32),    "0x20",    big_unsigned{32});
-        runTests(num_255,  uint64_t(255),   "0xff",    big_unsigned{255});
-        runTests(num_1025, uint64_t(1025),  "0x401",   big_unsigned{1025});
-        runTests(num_65536,uint64_t(65536), "0x10000", big_unsigned{65536});
+        runTests(num_10,   uint64_t(10),    "0xa",     BIG_UNSIGNED{10});
+        runTests(num_32,   uint64_t(32),    "0x20",    BIG_UNSIGNED{32});
+        runTests(num_255,  uint64_t(255),   "0xff",    BIG_UNSIGNED{255});
+        runTests(num_1025, uint64_t(1025),  "0x401",   BIG_UNSIGNED{1025});
+        runTests(num_65536,uint64_t(65536), "0x10000", BIG_UNSIGNED{65536});
 
         runTests(         num_0x123456789abcdef,
                      uint64_t(0x123456789abcdef),
                              "0x123456789abcdef",
-                 big_unsigned{0x123456789abcdef});
+                 BIG_UNSIGNED{0x123456789abcdef});
 
-        runTests(num_10,      uint8_t(10),     "0xa",     big_unsigned_with_type{10});
-        runTests(num_32_WT,   uint8_t(32),     "0x20",    big_unsigned_with_type{32});
-        runTests(num_255_WT,  uint8_t(255),    "0xff",    big_unsigned_with_type{255});
-        runTests(num_1025_WT, uint16_t(1025),  "0x401",   big_unsigned_with_type{1025});
-        runTests(num_65536_WT,uint32_t(65536), "0x10000", big_unsigned_with_type{65536});
+        runTests(num_10,      uint8_t(10),     "0xa",     BIG_UNSIGNED_WITH_TYPE{10});
+        runTests(num_32_WT,   uint8_t(32),     "0x20",    BIG_UNSIGNED_WITH_TYPE{32});
+        runTests(num_255_WT,  uint8_t(255),    "0xff",    BIG_UNSIGNED_WITH_TYPE{255});
+        runTests(num_1025_WT, uint16_t(1025),  "0x401",   BIG_UNSIGNED_WITH_TYPE{1025});
+        runTests(num_65536_WT,uint32_t(65536), "0x10000", BIG_UNSIGNED_WITH_TYPE{65536});
 
-        runTests(num_10,      uint64_t(10),    "0xa",     big_unsigned_with_type{10});
-        runTests(num_32_WT,   uint64_t(32),    "0x20",    big_unsigned_with_type{32});
-        runTests(num_255_WT,  uint64_t(255),   "0xff",    big_unsigned_with_type{255});
-        runTests(num_1025_WT, uint64_t(1025),  "0x401",   big_unsigned_with_type{1025});
-        runTests(num_65536_WT,uint64_t(65536), "0x10000", big_unsigned_with_type{65536});
+        runTests(num_10,      uint64_t(10),    "0xa",     BIG_UNSIGNED_WITH_TYPE{10});
+        runTests(num_32_WT,   uint64_t(32),    "0x20",    BIG_UNSIGNED_WITH_TYPE{32});
+        runTests(num_255_WT,  uint64_t(255),   "0xff",    BIG_UNSIGNED_WITH_TYPE{255});
+        runTests(num_1025_WT, uint64_t(1025),  "0x401",   BIG_UNSIGNED_WITH_TYPE{1025});
+        runTests(num_65536_WT,uint64_t(65536), "0x10000", BIG_UNSIGNED_WITH_TYPE{65536});
 
         runTests(         num_0x123456789abcdef_WT,
                      uint64_t(0x123456789abcdef),
                              "0x123456789abcdef",
-                 big_unsigned_with_type{0x123456789abcdef});
+                 BIG_UNSIGNED_WITH_TYPE{0x123456789abcdef});
 
         auto convert_all_directions = [&](auto value, auto test) {
             test = value;
@@ -196,7 +199,7 @@ void big_unsigned_test() {
         };
 
         auto type_test = [&](auto value) {
-            big_unsigned_with_type test{value};
+            BIG_UNSIGNED_WITH_TYPE test{value};
 
             for (unsigned val  = 0; val < (1 << GIT_TYPE_ENCODE_BITS); val++) {
                 test.set_reserved_bits(val);
@@ -207,20 +210,20 @@ void big_unsigned_test() {
 
         it("Back and forth conversion test", [&]() {
             for (unsigned i=0; i < 0x1000; i++) {
-                convert_all_directions(i * 7u,             big_unsigned{});
-                convert_all_directions(i * 0x7000u,        big_unsigned{});
-                convert_all_directions(i * 0x7000000u,     big_unsigned{});
-                convert_all_directions(i * 0x56789abcdefu, big_unsigned{});
-                convert_all_directions(i * 7u,             big_unsigned_big_endian{});
-                convert_all_directions(i * 0x7000u,        big_unsigned_big_endian{});
-                convert_all_directions(i * 0x7000000u,     big_unsigned_big_endian{});
-                convert_all_directions(i * 0x7000000u,     big_unsigned_big_endian{});
-                convert_all_directions(i * 0x56789abcdefu, big_unsigned_big_endian{});
-                convert_all_directions(i * 7u,             big_unsigned_with_type{});
-                convert_all_directions(i * 0x7000u,        big_unsigned_with_type{});
-                convert_all_directions(i * 0x7000000u,     big_unsigned_with_type{});
-                convert_all_directions(i * 0x7000000u,     big_unsigned_with_type{});
-                convert_all_directions(i * 0x56789abcdefu, big_unsigned_with_type{});
+                convert_all_directions(i * 7u,             BIG_UNSIGNED{});
+                convert_all_directions(i * 0x7000u,        BIG_UNSIGNED{});
+                convert_all_directions(i * 0x7000000u,     BIG_UNSIGNED{});
+                convert_all_directions(i * 0x56789abcdefu, BIG_UNSIGNED{});
+                convert_all_directions(i * 7u,             BIG_UNSIGNED_BIG_ENDIAN{});
+                convert_all_directions(i * 0x7000u,        BIG_UNSIGNED_BIG_ENDIAN{});
+                convert_all_directions(i * 0x7000000u,     BIG_UNSIGNED_BIG_ENDIAN{});
+                convert_all_directions(i * 0x7000000u,     BIG_UNSIGNED_BIG_ENDIAN{});
+                convert_all_directions(i * 0x56789abcdefu, BIG_UNSIGNED_BIG_ENDIAN{});
+                convert_all_directions(i * 7u,             BIG_UNSIGNED_WITH_TYPE{});
+                convert_all_directions(i * 0x7000u,        BIG_UNSIGNED_WITH_TYPE{});
+                convert_all_directions(i * 0x7000000u,     BIG_UNSIGNED_WITH_TYPE{});
+                convert_all_directions(i * 0x7000000u,     BIG_UNSIGNED_WITH_TYPE{});
+                convert_all_directions(i * 0x56789abcdefu, BIG_UNSIGNED_WITH_TYPE{});
                 type_test(i * 7u);
                 type_test(i * 0x7000u);
                 type_test(i * 0x7000000u);
@@ -230,3 +233,36 @@ void big_unsigned_test() {
         });
     });
 }
+
+}
+
+void big_unsigned_test() {
+    big_unsigned_suite<big_unsigned, big_unsigned_big_endian, big_unsigned_with_type>("fixed storage");
+    big_unsigned_suite<unbounded_big_unsigned, unbounded_big_unsigned_big_endian, unbounded_big_unsigned_with_type>("vector storage");
+
+    describe("big_unsigned fixed storage", [&]() {
+        it("rejects values longer than a pack header", [&]() {
+            std::stringstream stream{std::string(GIT_HEADER_MAX_BYTES + 1, '\x80')};
+            big_unsigned value;
+            bool overflow = false;
+            try {
+                value.binread(stream);
+            } catch (const std::overflow_error&) {
+                overflow = true;
+            }
+            AssertThat(overflow, Equals(true));
+        });
+
+        it("reads the longest pack header", [&]() {
+            std::stringstream stream{std::string(GIT_HEADER_MAX_BYTES - 1, '\x80') + '\x01'};
+            unbounded_big_unsigned expected;
+            expected.binread(stream);
+            stream.clear();
+            stream.seekg(0);
+            big_unsigned value;
+            value.binread(stream);
+            AssertThat(value.size(), Equals(GIT_HEADER_MAX_BYTES));
+            AssertThat(value.convert<uint64_t>(), Equals(expected.convert<uint64_t>()));
+        });
+    });
+}
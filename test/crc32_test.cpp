@@ -0,0 +1,41 @@
+#include "util/crc32.hpp"
+
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+#include "kernel_tests.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+void crc32_test() {
+    describe("crc32", [&]() {
+        auto checksum = [](const std::string& input) {
+            return crc32_checksum{}.update(input.data(), input.size()).value();
+        };
+
+        it("known vectors", [&]() {
+            AssertThat(checksum(""), Equals(0u));
+            AssertThat(checksum("123456789"), Equals(0xcbf43926u));
+            AssertThat(checksum(std::string(100, 'a')), Equals(0xaf707a64u));
+        });
+
+        it("incremental updates", [&]() {
+            std::string input(1000, 'x');
+            crc32_checksum incremental;
+            for (std::size_t i = 0; i < input.size(); i += 77) {
+                incremental.update(input.data() + i, std::min<std::size_t>(77, input.size() - i));
+            }
+            AssertThat(incremental.value(), Equals(checksum(input)));
+        });
+
+        it("computes the same with and without hardware support", [&]() {
+            // Starting at the second byte, so the hardware kernel reads unaligned data.
+            check_hardware_matches_portable<crc32_checksum>(
+                { 0, 1, 15, 16, 63, 64, 65, 80, 127, 128, 129, 1000, 99999 }, 1, checksum);
+        });
+    });
+}
@@ -0,0 +1,250 @@
+#include "pack/delta.hpp"
+#include "pack/delta_base_cache.hpp"
+#include "pack/loader.hpp"
+#include "pack/resolver.hpp"
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+#include "object_tests.hpp"
+
+#include "sample-pack-data.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+namespace {
+
+std::vector<char> bytes(const std::string& value) {
+    return std::vector<char>(value.begin(), value.end());
+}
+
+template <typename LOADER>
+std::string stream_hash(LOADER& loader, const std::string& name) {
+    auto& object = loader[name];
+    auto& stream = object.get_stream();
+    std::string content{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+    return object_hash(object.get_type(), content);
+}
+
+}
+
+void delta_test() {
+    describe("delta", [&]() {
+        auto base = bytes("hello delta world");
+
+        it("copies and inserts", [&]() {
+            // Sizes 17 and 15, copy 6 bytes at 0, insert "git ", copy 5 bytes at 12.
+            auto delta = bytes(std::string("\x11\x0f\x90\x06\x04git \x91\x0c\x05", 12));
+            AssertThat(std::string(apply_delta(base, delta).data(), 15), Equals("hello git world"));
+        });
+
+        it("reads multi byte sizes", [&]() {
+            std::vector<char> big_base(300, 'x');
+            auto delta = bytes(std::string("\xac\x02\x01\x01y", 5));
+            auto result = apply_delta(big_base, delta);
+            AssertThat(result.size(), Equals(1u));
+            AssertThat(result[0], Equals('y'));
+            AssertThat(delta::result_size(delta.data(), delta.size()), Equals(uint64_t{1}));
+        });
+
+        it("copy size 0 means 64KiB", [&]() {
+            std::vector<char> big_base(0x10000, 'z');
+            auto delta = bytes(std::string("\x80\x80\x04\x80\x80\x04\x80", 7));
+            AssertThat(apply_delta(big_base, delta) == big_base, Equals(true));
+        });
+
+        it("rejects corrupt deltas", [&]() {
+            AssertThat(throws_invalid_argument([&]() {
+                apply_delta(base, bytes(std::string("\x10\x01\x01x", 4)));
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                apply_delta(base, bytes(std::string("\x11\x05\x91\x10\x05", 5)));
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                apply_delta(base, bytes(std::string("\x11\x02\x01x", 4)));
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                apply_delta(base, bytes(std::string("\x11\x01\x00", 3)));
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                apply_delta(base, bytes(std::string("\x11\x01\x05x", 4)));
+            }), Equals(true));
+        });
+
+        it("rejects sizes with bits past 64", [&]() {
+            // 9 * 7 bits so far, the last byte may only add the one bit left.
+            auto largest = bytes(std::string("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01\x00", 11));
+            AssertThat(delta::result_size(largest.data(), largest.size()), Equals(uint64_t{0}));
+
+            auto over = bytes(std::string("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02\x00", 11));
+            AssertThat(throws_invalid_argument([&]() {
+                delta::result_size(over.data(), over.size());
+            }), Equals(true));
+        });
+    });
+
+    describe("delta base cache", [&]() {
+        auto content = [](std::size_t size) {
+            return std::make_shared<const std::vector<char>>(size, 'c');
+        };
+
+        it("evicts the least recently used", [&]() {
+            delta_base_cache cache{100};
+            cache.put(1, content(40));
+            cache.put(2, content(40));
+            AssertThat(cache.get(1) != nullptr, Equals(true));
+            cache.put(3, content(40));
+
+            AssertThat(cache.get(2) == nullptr, Equals(true));
+            AssertThat(cache.get(1) != nullptr, Equals(true));
+            AssertThat(cache.get(3) != nullptr, Equals(true));
+            AssertThat(cache.get_used(), Equals(80u));
+        });
+
+        it("skips what does not fit", [&]() {
+            delta_base_cache cache{100};
+            cache.put(1, content(101));
+            AssertThat(cache.size(), Equals(0u));
+
+            cache.put(1, content(50));
+            cache.set_limit(0);
+            AssertThat(cache.size(), Equals(0u));
+            cache.put(2, content(0));
+            AssertThat(cache.size(), Equals(0u));
+        });
+
+        it("replaces entries", [&]() {
+            delta_base_cache cache{100};
+            cache.put(1, content(30));
+            cache.put(1, content(60));
+            AssertThat(cache.size(), Equals(1u));
+            AssertThat(cache.get_used(), Equals(60u));
+        });
+    });
+
+    describe("delta resolution", [&]() {
+        const std::string pack_path{TEST_RESOURCE_PATH "/sample_pack"};
+
+        it("rebuilds every object", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            for (const auto& expected: data::get_expected_objects()) {
+                AssertThat(stream_hash(loader, expected.name), Equals(expected.name));
+            }
+        });
+
+        it("rebuilds every object without cache", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            loader.set_delta_base_cache_limit(0);
+            for (const auto& expected: data::get_expected_objects()) {
+                AssertThat(stream_hash(loader, expected.name), Equals(expected.name));
+            }
+        });
+
+        it("reads whole objects at once", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            for (const auto& expected: data::get_expected_objects()) {
+                const auto& object = loader[expected.name];
+                auto content = object.read_content();
+                AssertThat(object_hash(object.get_type(), std::string(content.begin(), content.end())), Equals(expected.name));
+
+                std::vector<char> destination(content.size());
+                object.read_content(destination.data(), destination.size());
+                AssertThat(destination == content, Equals(true));
+            }
+        });
+
+        it("views whole objects", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            for (const auto& expected: data::get_expected_objects()) {
+                object_descriptor_base& object = loader[expected.name];
+                auto content = object.get_content();
+                AssertThat(object_hash(loader[expected.name].get_type(), std::string(content.begin(), content.end())),
+                           Equals(expected.name));
+            }
+        });
+
+        it("rejects destinations of the wrong size", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            for (const auto& expected: data::get_expected_objects()) {
+                const auto& object = loader[expected.name];
+                std::vector<char> destination(object.read_content().size() + 1);
+                AssertThat(throws_invalid_argument([&]() {
+                    object.read_content(destination.data(), destination.size());
+                }), Equals(true));
+            }
+        });
+
+        it("rebuilds objects of other packs", [&]() {
+            for (const auto& entry: fs::directory_iterator(TEST_RESOURCE_PATH "/multi_pack")) {
+                if (entry.path().extension() != INDEX_FILE_EXTENSION) {
+                    continue;
+                }
+                auto loader = pack_file_parser(entry.path());
+                for (const auto& item: loader.get_index()) {
+                    auto name = item.get_name().to_string();
+                    AssertThat(stream_hash(loader, name), Equals(name));
+                }
+            }
+        });
+    });
+
+    describe("pack resolver", [&]() {
+        auto pack_path = std::string(TEST_RESOURCE_PATH "/sample_pack");
+
+        auto resolve_all = [&](std::size_t threads, std::size_t memory_limit) {
+            auto loader = pack_file_parser(pack_path);
+            pack_resolver<decltype(loader)> resolver{loader, threads};
+            resolver.set_memory_limit(memory_limit);
+
+            std::mutex lock;
+            std::map<std::string, unsigned> seen;
+            std::map<std::string, std::string> hashes;
+            resolver.resolve([&](const object_id& name, const std::string& type, const std::vector<char>& content) {
+                auto hash = object_hash(type, std::string(content.begin(), content.end()));
+                std::lock_guard<std::mutex> guard{lock};
+                seen[name.to_string()]++;
+                hashes[name.to_string()] = hash;
+            });
+
+            AssertThat(seen.size(), Equals(data::get_expected_objects().size()));
+            for (const auto& expected: data::get_expected_objects()) {
+                AssertThat(seen[expected.name], Equals(1u));
+                AssertThat(hashes[expected.name], Equals(expected.name));
+            }
+        };
+
+        it("rebuilds every object once", [&]() {
+            resolve_all(1, pack_resolver<decltype(pack_file_parser(pack_path))>::DEFAULT_MEMORY_LIMIT);
+        });
+
+        it("rebuilds every object from many threads", [&]() {
+            resolve_all(8, pack_resolver<decltype(pack_file_parser(pack_path))>::DEFAULT_MEMORY_LIMIT);
+        });
+
+        it("rebuilds bases again when over the memory limit", [&]() {
+            resolve_all(4, 0);
+        });
+
+        it("stops on callback errors", [&]() {
+            auto loader = pack_file_parser(pack_path);
+            pack_resolver<decltype(loader)> resolver{loader, 4};
+            bool stopped = false;
+            try {
+                resolver.resolve([](const object_id&, const std::string&, const std::vector<char>&) {
+                    throw std::runtime_error("stop");
+                });
+            } catch (const std::runtime_error&) {
+                stopped = true;
+            }
+            AssertThat(stopped, Equals(true));
+        });
+    });
+}
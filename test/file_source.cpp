@@ -20,6 +20,19 @@ void file_source_test() {
             AssertThat(mapped[2], Equals('3'));
             AssertThat(mapped[3], Equals('4'));
         });
+
+        it("views outlive the mapper", []() {
+            byte_view view;
+            {
+                file_mapper<char> mapped{SAMPLE_TEST_FILE};
+                view = mapped.view(5, 4);
+            }
+            AssertThat(std::string(view.begin(), view.end()), Equals("5678"));
+
+            auto part = view.subview(1, 2);
+            AssertThat(std::string(part.begin(), part.end()), Equals("67"));
+            AssertThat(part.size(), Equals(2u));
+        });
     });
 
     auto fdev = device_source<file_device>(SAMPLE_TEST_FILE);
@@ -84,5 +97,30 @@ void file_source_test() {
             AssertThat(a, Equals("9abc"));
         });
 
+        it("file_device_subsource_seek", [&]() {
+            auto stream = fdev.subsource(5, 10).stream();
+            stream->seekg(2);
+            std::string a;
+            *stream >> a;
+            AssertThat(a, Equals("78"));
+            stream->clear();
+            stream->seekg(-5, std::ios_base::end);
+            AssertThat(static_cast<long>(stream->tellg()), Equals(5l));
+            *stream >> a;
+            AssertThat(a, Equals("9abc"));
+        });
+
+        it("file_device_bulk_read", [&]() {
+            auto stream = fdev.subsource(5, 10).stream();
+            AssertThat(static_cast<long>(stream->rdbuf()->in_avail()), Equals(10l));
+
+            std::vector<char> buffer(16, 0);
+            stream->read(buffer.data(), buffer.size());
+            AssertThat(static_cast<long>(stream->gcount()), Equals(10l));
+            AssertThat(std::string(buffer.data(), 4), Equals("5678"));
+            AssertThat(stream->eof(), Equals(true));
+            AssertThat(static_cast<long>(stream->rdbuf()->in_avail()), Equals(-1l));
+        });
+
     });
 }
@@ -0,0 +1,215 @@
+#ifndef INDEX_GENERATOR_HPP_INCLUDED
+#define INDEX_GENERATOR_HPP_INCLUDED
+
+#include "object_id.hpp"
+#include "util/filesystem.hpp"
+#include "util/sha1dc.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+namespace generator {
+
+struct index_entry {
+    git::object_id name;
+    uint64_t offset;
+    uint32_t crc;
+};
+
+template <typename INT>
+void write_netorder(std::ostream& out, INT value) {
+    char buffer[sizeof(INT)];
+    for (int i = sizeof(INT) - 1; i >= 0; i--) {
+        buffer[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    out.write(buffer, sizeof(buffer));
+}
+
+/// Writes a v2 pack index, offsets that do not fit in 31 bits go to the large offset table.
+inline void write_index(const git::fs::path& path, std::vector<index_entry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.name < b.name;
+    });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write("\xfftOc", 4);
+    write_netorder<uint32_t>(out, 2);
+
+    uint32_t count = 0;
+    for (unsigned bucket = 0; bucket < 256; bucket++) {
+        while (count < entries.size() && entries[count].name[0] == bucket) {
+            count++;
+        }
+        write_netorder(out, count);
+    }
+
+    for (const auto& entry: entries) {
+        out.write(reinterpret_cast<const char*>(entry.name.data()), entry.name.size());
+    }
+    for (const auto& entry: entries) {
+        write_netorder(out, entry.crc);
+    }
+
+    std::vector<uint64_t> large_offsets;
+    for (const auto& entry: entries) {
+        if (entry.offset < 0x80000000) {
+            write_netorder(out, static_cast<uint32_t>(entry.offset));
+        } else {
+            write_netorder(out, static_cast<uint32_t>(0x80000000 | large_offsets.size()));
+            large_offsets.push_back(entry.offset);
+        }
+    }
+    for (auto offset: large_offsets) {
+        write_netorder(out, offset);
+    }
+
+    // Pack and index checksums are not verified by the reader.
+    std::string trailer(2 * git::OBJECT_NAME_SIZE, '\0');
+    out.write(trailer.data(), trailer.size());
+}
+
+struct multi_index_entry {
+    git::object_id name;
+    uint32_t pack;
+    uint32_t offset;
+};
+
+/** Writes a multi-pack-index without a large offset chunk, entries must be sorted.
+ *
+ * Entries are written as given so broken files can be made. claimed_count, when not 0,
+ * replaces the object count of the fanout.
+ */
+inline void write_multi_index(const git::fs::path& path, const std::vector<std::string>& packs,
+        const std::vector<multi_index_entry>& entries, uint32_t claimed_count = 0) {
+    std::string pack_names;
+    for (const auto& pack: packs) {
+        pack_names += pack;
+        pack_names.push_back('\0');
+    }
+    pack_names.resize((pack_names.size() + 3) / 4 * 4, '\0');
+
+    const uint32_t chunks[] = { 0x504e414d, 0x4f494446, 0x4f49444c, 0x4f4f4646 }; // PNAM OIDF OIDL OOFF
+    uint64_t sizes[] = { pack_names.size(), 256 * 4, entries.size() * git::OBJECT_NAME_SIZE, entries.size() * 8 };
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write("MIDX", 4);
+    out.put(1);
+    out.put(1);
+    out.put(4);
+    out.put(0);
+    write_netorder<uint32_t>(out, packs.size());
+
+    uint64_t offset = 12 + 5 * 12;
+    for (unsigned i = 0; i < 4; i++) {
+        write_netorder(out, chunks[i]);
+        write_netorder(out, offset);
+        offset += sizes[i];
+    }
+    write_netorder<uint32_t>(out, 0);
+    write_netorder(out, offset);
+
+    out.write(pack_names.data(), pack_names.size());
+    uint32_t count = 0;
+    for (unsigned bucket = 0; bucket < 256; bucket++) {
+        while (count < entries.size() && entries[count].name[0] == bucket) {
+            count++;
+        }
+        write_netorder(out, bucket == 255 && claimed_count ? claimed_count : count);
+    }
+    for (const auto& entry: entries) {
+        out.write(reinterpret_cast<const char*>(entry.name.data()), entry.name.size());
+    }
+    for (const auto& entry: entries) {
+        write_netorder(out, entry.pack);
+        write_netorder(out, entry.offset);
+    }
+
+    // The checksum is not verified by the reader.
+    std::string trailer(git::OBJECT_NAME_SIZE, '\0');
+    out.write(trailer.data(), trailer.size());
+}
+
+/// Type and size header of a pack object.
+inline std::string object_header(unsigned type, uint64_t size) {
+    std::string result;
+    uint8_t byte = static_cast<uint8_t>((type << 4) | (size & 0x0f));
+    size >>= 4;
+    while (size > 0) {
+        result.push_back(static_cast<char>(byte | 0x80));
+        byte = size & 0x7f;
+        size >>= 7;
+    }
+    result.push_back(static_cast<char>(byte));
+    return result;
+}
+
+inline std::string deflate(const std::string& content) {
+    uLongf compressed_size = compressBound(content.size());
+    std::string compressed(compressed_size, '\0');
+    compress(reinterpret_cast<Bytef*>(&compressed[0]), &compressed_size,
+             reinterpret_cast<const Bytef*>(content.data()), content.size());
+    compressed.resize(compressed_size);
+    return compressed;
+}
+
+/// Encodes a non delta pack object (header followed by the deflated content).
+inline std::string pack_object(unsigned type, const std::string& content) {
+    return object_header(type, content.size()) + deflate(content);
+}
+
+/// Encodes a REF_DELTA pack object against the object named base.
+inline std::string pack_ref_delta(const git::object_id& base, const std::string& delta) {
+    auto name = std::string(reinterpret_cast<const char*>(base.data()), base.size());
+    return object_header(7, delta.size()) + name + deflate(delta);
+}
+
+/// Name git gives to a blob with this content.
+inline git::object_id blob_name(const std::string& content) {
+    return git::hash_object("blob", content.data(), content.size());
+}
+
+/// A whole pack: header, the encoded objects and the trailing checksum.
+inline std::string pack_contents(const std::vector<std::string>& objects) {
+    std::ostringstream header;
+    header.write("PACK", 4);
+    write_netorder<uint32_t>(header, 2);
+    write_netorder<uint32_t>(header, objects.size());
+
+    auto pack = header.str();
+    for (const auto& object: objects) {
+        pack += object;
+    }
+    git::sha1 checksum;
+    checksum.update(pack);
+    auto digest = checksum.finish();
+    return pack + std::string(reinterpret_cast<const char*>(digest.data()), digest.size());
+}
+
+/// Writes a sparse pack, each object is placed at its given offset and the gaps are holes.
+inline void write_sparse_pack(const git::fs::path& path, uint64_t size,
+        const std::vector<std::pair<uint64_t, std::string>>& objects) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write("PACK", 4);
+        write_netorder<uint32_t>(out, 2);
+        write_netorder<uint32_t>(out, objects.size());
+    }
+    git::fs::resize_file(path, size);
+
+    std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+    for (const auto& object: objects) {
+        out.seekp(object.first);
+        out.write(object.second.data(), object.second.size());
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#include "pack/indexer.hpp"
+#include "pack/loader.hpp"
+#include "util/sha1.hpp"
+
+#include "index_generator.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+namespace {
+
+std::string read_file(const fs::path& path) {
+    std::ifstream input(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+/// Delta that ignores a base of base_size bytes and inserts content, at most 127 bytes.
+std::string insert_delta(std::size_t base_size, const std::string& content) {
+    return std::string(1, static_cast<char>(base_size)) + static_cast<char>(content.size())
+        + static_cast<char>(content.size()) + content;
+}
+
+bool fails_to_index(const pack_indexer& indexer, std::istream& input) {
+    try {
+        indexer.index(input);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+std::size_t file_count(const fs::path& directory) {
+    return std::distance(fs::directory_iterator(directory), fs::directory_iterator());
+}
+
+}
+
+void indexer_test() {
+    describe("pack indexer", [&]() {
+        auto directory = fs::temp_directory_path() / "gitpp_indexer";
+        auto sample_pack = fs::path(TEST_RESOURCE_PATH) / "sample_pack.pack";
+        auto sample_index = fs::path(TEST_RESOURCE_PATH) / "sample_pack.idx";
+
+        before_each([&]() {
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+        });
+
+        auto index_sample = [&](pack_indexer& indexer) {
+            std::ifstream input(sample_pack, std::ios::binary);
+            auto result = indexer.index(input);
+            AssertThat(result.object_count, Equals(14u));
+            AssertThat(read_file(result.pack_path), Equals(read_file(sample_pack)));
+            AssertThat(read_file(result.index_path), Equals(read_file(sample_index)));
+            AssertThat(file_count(directory), Equals(2u));
+        };
+
+        it("writes the same index as git", [&]() {
+            pack_indexer indexer{directory, 1};
+            index_sample(indexer);
+        });
+
+        it("names the pack after its checksum", [&]() {
+            pack_indexer indexer{directory, 1};
+            std::ifstream input(sample_pack, std::ios::binary);
+            auto result = indexer.index(input);
+            auto expected = "pack-" + result.checksum.to_string();
+            AssertThat(result.pack_path, Equals(directory / (expected + ".pack")));
+            AssertThat(result.index_path, Equals(directory / (expected + ".idx")));
+        });
+
+        it("resolves deltas from many threads", [&]() {
+            pack_indexer indexer{directory, 4};
+            index_sample(indexer);
+        });
+
+        it("rebuilds bases again when over the memory limit", [&]() {
+            pack_indexer indexer{directory, 2};
+            indexer.set_memory_limit(0);
+            index_sample(indexer);
+        });
+
+        it("reads objects split across buffer refills", [&]() {
+            pack_indexer indexer{directory, 1};
+            indexer.set_buffer_size(1);
+            index_sample(indexer);
+        });
+
+        it("resolves deltas by name in any order", [&]() {
+            std::string base = "base content";
+            std::string first = "first version";
+            std::string second = "second version";
+            auto base_name = generator::blob_name(base);
+            auto first_name = generator::blob_name(first);
+
+            // The second delta comes before its base, which is itself a delta.
+            auto second_delta = generator::pack_ref_delta(first_name, insert_delta(first.size(), second));
+            auto pack = generator::pack_contents({
+                second_delta,
+                generator::pack_object(3, base),
+                generator::pack_ref_delta(base_name, insert_delta(base.size(), first)),
+            });
+            std::istringstream input(pack);
+            pack_indexer indexer{directory, 2};
+            auto result = indexer.index(input);
+
+            auto loader = pack_file_parser(result.pack_path);
+            AssertThat(loader.size(), Equals(3u));
+            AssertThat(loader.get_index()[base_name].get_pack_offset(), Equals(12u + second_delta.size()));
+            auto content = loader[generator::blob_name(second)].get_content();
+            AssertThat(std::string(content.data(), content.size()), Equals(second));
+            AssertThat(loader[first_name].get_type(), Equals("blob"));
+        });
+
+        it("resolves a REF_DELTA once when its base is in the pack twice", [&]() {
+            std::string base = "twice stored";
+            std::string version = "one delta";
+            auto pack = generator::pack_contents({
+                generator::pack_object(3, base),
+                generator::pack_object(3, base),
+                generator::pack_ref_delta(generator::blob_name(base), insert_delta(base.size(), version)),
+            });
+            for (std::size_t threads: { 1, 4 }) {
+                fs::remove_all(directory);
+                fs::create_directories(directory);
+                std::istringstream input(pack);
+                pack_indexer indexer{directory, threads};
+                auto result = indexer.index(input);
+                AssertThat(result.object_count, Equals(3u));
+
+                auto loader = pack_file_parser(result.pack_path);
+                auto content = loader[generator::blob_name(version)].get_content();
+                AssertThat(std::string(content.data(), content.size()), Equals(version));
+            }
+        });
+
+        it("writes large offsets", [&]() {
+            auto small = object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e");
+            auto large = object_id::from_hex("0a0b0c0d0e0f101112131415161718191a1b1c1d");
+            auto base = directory / "large";
+            write_pack_index(get_index_path(base), {
+                { small, 12, 1 },
+                { large, 0x100000010, 2 }
+            }, object_id{});
+
+            auto index = index_file_parser(base);
+            AssertThat(index.size(), Equals(2u));
+            AssertThat(index[small].get_pack_offset(), Equals(12u));
+            AssertThat(index[large].get_pack_offset(), Equals(0x100000010u));
+            AssertThat(index[large].get_crc(), Equals(2u));
+        });
+
+        it("rejects thin packs", [&]() {
+            auto missing = generator::blob_name("missing");
+            std::istringstream input(generator::pack_contents({
+                generator::pack_object(3, "present"),
+                generator::pack_ref_delta(missing, insert_delta(7, "thin")),
+            }));
+            pack_indexer indexer{directory, 1};
+            AssertThat(fails_to_index(indexer, input), Equals(true));
+            AssertThat(file_count(directory), Equals(0u));
+        });
+
+        it("rejects truncated packs", [&]() {
+            auto pack = read_file(sample_pack);
+            std::istringstream input(pack.substr(0, pack.size() / 2));
+            pack_indexer indexer{directory, 1};
+            AssertThat(fails_to_index(indexer, input), Equals(true));
+            AssertThat(file_count(directory), Equals(0u));
+        });
+
+        it("rejects packs with a wrong checksum", [&]() {
+            auto pack = read_file(sample_pack);
+            pack.back() ^= 1;
+            std::istringstream input(pack);
+            pack_indexer indexer{directory, 1};
+            AssertThat(fails_to_index(indexer, input), Equals(true));
+            AssertThat(file_count(directory), Equals(0u));
+        });
+    });
+}
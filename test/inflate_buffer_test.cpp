@@ -0,0 +1,104 @@
+#include "streams/inflate_buffer.hpp"
+
+#include <istream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <bandit/bandit.h>
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+namespace {
+
+std::string deflate(const std::string& input) {
+    std::string output(compressBound(input.size()), '\0');
+    uLongf size = output.size();
+    compress(reinterpret_cast<Bytef*>(&output[0]), &size, reinterpret_cast<const Bytef*>(input.data()), input.size());
+    output.resize(size);
+    return output;
+}
+
+std::string read_all(std::streambuf& buffer) {
+    std::istream stream{&buffer};
+    return std::string{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+}
+
+void inflate_buffer_test() {
+    describe("inflate buffer", [&]() {
+        std::string content;
+        for (int i = 0; i < 5000; i++) {
+            content += "line " + std::to_string(i) + "\n";
+        }
+        auto compressed = deflate(content);
+
+        it("inflates memory", [&]() {
+            inflate_buffer buffer{nullptr, compressed.data(), compressed.size()};
+            AssertThat(read_all(buffer) == content, Equals(true));
+        });
+
+        it("inflates from a stream buffer", [&]() {
+            inflate_buffer buffer{std::make_unique<std::stringbuf>(compressed), nullptr, 0};
+            AssertThat(read_all(buffer) == content, Equals(true));
+        });
+
+        it("skips and limits", [&]() {
+            inflate_buffer buffer{nullptr, compressed.data(), compressed.size(), 20000, 10};
+            AssertThat(read_all(buffer), Equals(content.substr(20000, 10)));
+        });
+
+        it("reuses inflate states", [&]() {
+            {
+                inflate_buffer first{nullptr, compressed.data(), compressed.size()};
+            }
+            auto idle = inflater_pool::idle_count();
+            AssertThat(idle > 0, Equals(true));
+            {
+                inflate_buffer second{nullptr, compressed.data(), compressed.size()};
+                AssertThat(inflater_pool::idle_count(), Equals(idle - 1));
+                AssertThat(read_all(second) == content, Equals(true));
+            }
+            AssertThat(inflater_pool::idle_count(), Equals(idle));
+        });
+
+        it("inflates in one go", [&]() {
+            std::string destination(content.size(), '\0');
+            inflate_into(compressed.data(), compressed.size(), &destination[0], destination.size());
+            AssertThat(destination == content, Equals(true));
+        });
+
+        it("checks the size of one go inflates", [&]() {
+            auto fails = [&](std::size_t size) {
+                std::string destination(size, '\0');
+                try {
+                    inflate_into(compressed.data(), compressed.size(), &destination[0], destination.size());
+                } catch (const std::runtime_error&) {
+                    return true;
+                }
+                return false;
+            };
+            AssertThat(fails(content.size() - 1), Equals(true));
+            AssertThat(fails(content.size() + 1), Equals(true));
+            AssertThat(fails(content.size()), Equals(false));
+        });
+
+        it("reports corrupt data", [&]() {
+            auto corrupt = compressed;
+            corrupt[0] = 0;
+            inflate_buffer buffer{nullptr, corrupt.data(), corrupt.size()};
+            std::istream stream{&buffer};
+            stream.exceptions(std::ios_base::badbit);
+            bool thrown = false;
+            try {
+                stream.get();
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            AssertThat(thrown, Equals(true));
+        });
+    });
+}
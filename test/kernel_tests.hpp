@@ -0,0 +1,39 @@
+#ifndef KERNEL_TESTS_HPP_INCLUDED
+#define KERNEL_TESTS_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+/** Checks that digest() gives the same with and without the hardware kernel of IMPL.
+ *
+ * IMPL has the use_hardware() and accelerated() of kernel_dispatch. Inputs of each size
+ * start at offset, so kernels also read unaligned data. The hardware kernel is turned
+ * back on when the CPU has it.
+ */
+template <typename IMPL, typename DIGEST>
+void check_hardware_matches_portable(const std::vector<std::size_t>& sizes, std::size_t offset, DIGEST digest) {
+    using namespace snowhouse;
+
+    std::string input;
+    for (unsigned i = 0; i < 100000 + offset; i++) {
+        input.push_back(static_cast<char>(i * 7919 >> 3));
+    }
+
+    auto hardware = IMPL::use_hardware(true);
+    std::vector<decltype(digest(input))> expected;
+    for (auto size: sizes) {
+        expected.push_back(digest(input.substr(offset, size)));
+    }
+
+    AssertThat(IMPL::use_hardware(false), Equals(false));
+    AssertThat(IMPL::accelerated(), Equals(false));
+    for (std::size_t i = 0; i < sizes.size(); i++) {
+        AssertThat(digest(input.substr(offset, sizes[i])), Equals(expected[i]));
+    }
+
+    AssertThat(IMPL::use_hardware(true), Equals(hardware));
+}
+
+#endif
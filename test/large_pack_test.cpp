@@ -0,0 +1,75 @@
+#include "pack/loader.hpp"
+
+#include "index_generator.hpp"
+
+#include <iterator>
+#include <string>
+
+#include <bandit/bandit.h>
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+void large_pack_test() {
+    describe("packs larger than 4GiB", [&]() {
+        static constexpr uint64_t SMALL_OFFSET = 12;
+        static constexpr uint64_t LARGE_OFFSET = 0x100000010;
+        static constexpr uint64_t LARGER_OFFSET = 0x180000000;
+        static constexpr uint64_t PACK_SIZE = 0x180000100;
+
+        auto base = fs::temp_directory_path() / "gitpp_large_pack";
+        auto index_path = get_index_path(base);
+        auto pack_path = get_pack_path(base);
+
+        auto small = object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e");
+        auto large = object_id::from_hex("0a0b0c0d0e0f101112131415161718191a1b1c1d");
+        auto larger = object_id::from_hex("fc4f86dd288c1286cf2fd5c8f34cc1e43351c79b");
+
+        generator::write_index(index_path, {
+            { small, SMALL_OFFSET, 1 },
+            { large, LARGE_OFFSET, 2 },
+            { larger, LARGER_OFFSET, 3 }
+        });
+        generator::write_sparse_pack(pack_path, PACK_SIZE, {
+            { SMALL_OFFSET, generator::pack_object(3, "small blob") },
+            { LARGE_OFFSET, generator::pack_object(3, "blob after 4GiB") },
+            { LARGER_OFFSET, generator::pack_object(3, "last blob") }
+        });
+
+        it("reads large offsets from the index", [&]() {
+            auto index = index_file_parser(base);
+            AssertThat(index.size(), Equals(3u));
+            AssertThat(index[small].get_pack_offset(), Equals(SMALL_OFFSET));
+            AssertThat(index[large].get_pack_offset(), Equals(LARGE_OFFSET));
+            AssertThat(index[larger].get_pack_offset(), Equals(LARGER_OFFSET));
+            AssertThat(index[larger].get_crc(), Equals(3u));
+            AssertThat(index.next(index[large]).get_name(), Equals(larger));
+        });
+
+        it("maps and reads objects beyond 4GiB", [&]() {
+            auto loader = pack_file_parser(base);
+
+            auto read_all = [](auto& object) {
+                auto& stream = object.get_stream();
+                return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+            };
+
+            auto& first = loader[small];
+            AssertThat(read_all(first), Equals("small blob"));
+
+            auto& second = loader[large];
+            AssertThat(second.get_pack_offset(), Equals(LARGE_OFFSET));
+            AssertThat(second.get_pack_size(), Equals(LARGER_OFFSET - LARGE_OFFSET));
+            AssertThat(second.get_size(), Equals(15u));
+            AssertThat(read_all(second), Equals("blob after 4GiB"));
+
+            auto& third = loader[larger];
+            AssertThat(third.get_pack_size(), Equals(PACK_SIZE - LARGER_OFFSET - 20));
+            AssertThat(read_all(third), Equals("last blob"));
+        });
+
+        fs::remove(index_path);
+        fs::remove(pack_path);
+    });
+}
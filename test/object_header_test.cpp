@@ -0,0 +1,101 @@
+#include "pack/object_header.hpp"
+#include "util/big_unsigned.hpp"
+
+#include <sstream>
+#include <string>
+
+#include <bandit/bandit.h>
+
+#include "object_tests.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+namespace {
+
+constexpr uint8_t blob_300[] = { 0xbc, 0x12 };
+constexpr uint8_t commit_5[] = { 0x15 };
+constexpr uint8_t offset_1025[] = { 0x87, 0x01 };
+
+static_assert(pack_header::read_object_header(std::begin(blob_300), std::end(blob_300)).type == 3, "");
+static_assert(pack_header::read_object_header(std::begin(blob_300), std::end(blob_300)).size == 300, "");
+static_assert(pack_header::read_object_header(std::begin(blob_300), std::end(blob_300)).length == 2, "");
+static_assert(pack_header::read_object_header(std::begin(commit_5), std::end(commit_5)).size == 5, "");
+static_assert(pack_header::read_delta_offset(std::begin(offset_1025), std::end(offset_1025)).offset == 1025, "");
+static_assert(pack_header::read_delta_offset(std::begin(offset_1025), std::end(offset_1025)).length == 2, "");
+
+template <typename BIG_UNSIGNED>
+BIG_UNSIGNED big_unsigned_read(const std::string& encoded) {
+    std::stringstream stream{encoded};
+    BIG_UNSIGNED result;
+    result.binread(stream);
+    return result;
+}
+
+}
+
+void object_header_test() {
+    describe("pack object header", [&]() {
+        const std::string header("\x8f\xde\xf9\xea\xc4\xe7\x8a\x8d\x09", 9);
+        const std::string offset("\x80\x90\xd0\xab\xf7\xcc\xae\x9a\x6f", 9);
+
+        auto bytes = [](const std::string& value) {
+            return reinterpret_cast<const uint8_t*>(value.data());
+        };
+
+        it("reads type and size as big_unsigned_with_type", [&]() {
+            auto decoded = pack_header::read_object_header(bytes(header), bytes(header) + header.size());
+            auto expected = big_unsigned_read<big_unsigned_with_type>(header);
+            AssertThat(decoded.size, Equals(uint64_t{0x123456789abcdef}));
+            AssertThat(decoded.size, Equals(expected.convert<uint64_t>()));
+            AssertThat(unsigned{decoded.type}, Equals(expected.get_reserved_bits()));
+            AssertThat(std::size_t{decoded.length}, Equals(expected.size()));
+        });
+
+        it("reads delta offsets as big_unsigned", [&]() {
+            auto decoded = pack_header::read_delta_offset(bytes(offset), bytes(offset) + offset.size());
+            auto expected = big_unsigned_read<big_unsigned>(offset);
+            AssertThat(decoded.offset, Equals(uint64_t{0x123456789abcdef}));
+            AssertThat(decoded.offset, Equals(expected.convert<uint64_t>()));
+            AssertThat(std::size_t{decoded.length}, Equals(expected.size()));
+        });
+
+        it("stops at the end of the header", [&]() {
+            const std::string followed = header + "\x78\x9c";
+            auto decoded = pack_header::read_object_header(bytes(followed), bytes(followed) + followed.size());
+            AssertThat(decoded.length, Equals(9u));
+        });
+
+        it("rejects truncated headers", [&]() {
+            AssertThat(throws_invalid_argument([&]() {
+                pack_header::read_object_header(bytes(header), bytes(header) + 4);
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                pack_header::read_delta_offset(bytes(offset), bytes(offset));
+            }), Equals(true));
+        });
+
+        it("rejects values over 64 bits", [&]() {
+            const std::string too_long(11, '\xff');
+            AssertThat(throws_invalid_argument([&]() {
+                pack_header::read_object_header(bytes(too_long), bytes(too_long) + too_long.size());
+            }), Equals(true));
+            AssertThat(throws_invalid_argument([&]() {
+                pack_header::read_delta_offset(bytes(too_long), bytes(too_long) + too_long.size());
+            }), Equals(true));
+        });
+
+        it("rejects sizes with bits past 64", [&]() {
+            // 4 + 8 * 7 bits so far, the last byte may only add the 4 bits left.
+            const std::string largest("\x8f\xff\xff\xff\xff\xff\xff\xff\xff\x0f", 10);
+            auto decoded = pack_header::read_object_header(bytes(largest), bytes(largest) + largest.size());
+            AssertThat(decoded.size, Equals(~uint64_t{0}));
+
+            const std::string over("\x8f\xff\xff\xff\xff\xff\xff\xff\xff\x1f", 10);
+            AssertThat(throws_invalid_argument([&]() {
+                pack_header::read_object_header(bytes(over), bytes(over) + over.size());
+            }), Equals(true));
+        });
+    });
+}
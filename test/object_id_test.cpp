@@ -0,0 +1,69 @@
+#include "object_id.hpp"
+
+#include <sstream>
+#include <unordered_set>
+
+#include <bandit/bandit.h>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+void object_id_test() {
+    describe("object id", [&]() {
+        const std::string name_a = "31b3469089c90a7d1e1177a38a07e6be9b0c4e6f";
+        const std::string name_b = "3bb2a5be07fc75b1edfecd7ade1b29261850526e";
+
+        it("hex round trip", [&]() {
+            auto id = object_id::from_hex(name_a);
+            AssertThat(id.to_string(), Equals(name_a));
+            AssertThat(+id[0], Equals(0x31));
+            AssertThat(+id[19], Equals(0x6f));
+        });
+
+        it("upper case hex", [&]() {
+            AssertThat(object_id::from_hex("31B3469089C90A7D1E1177A38A07E6BE9B0C4E6F"), Equals(object_id::from_hex(name_a)));
+        });
+
+        it("rejects malformed names", [&]() {
+            bool thrown = false;
+            try {
+                object_id::from_hex("31b346");
+            } catch (const std::invalid_argument&) {
+                thrown = true;
+            }
+            AssertThat(thrown, Equals(true));
+        });
+
+        it("prefixes", [&]() {
+            auto prefix = object_id_prefix::from_hex("31b34");
+            auto id = object_id::from_hex(name_a);
+            AssertThat(prefix.size(), Equals(5u));
+            AssertThat(prefix.compare(id.data()), Equals(0));
+            AssertThat(prefix.compare(object_id::from_hex(name_b).data()) < 0, Equals(true));
+            AssertThat(object_id_prefix::from_hex("31b35").compare(id.data()) > 0, Equals(true));
+            AssertThat(common_prefix_length(id.data(), object_id::from_hex(name_b).data()), Equals(1u));
+            AssertThat(common_prefix_length(id.data(), id.data()), Equals(40u));
+        });
+
+        it("comparison", [&]() {
+            auto a = object_id::from_hex(name_a);
+            auto b = object_id::from_hex(name_b);
+            AssertThat(a < b, Equals(true));
+            AssertThat(b < a, Equals(false));
+            AssertThat(a == a, Equals(true));
+            AssertThat(a != b, Equals(true));
+            AssertThat(object_id{}.is_null(), Equals(true));
+            AssertThat(a.is_null(), Equals(false));
+        });
+
+        it("hash and output", [&]() {
+            std::unordered_set<object_id> ids{object_id::from_hex(name_a), object_id::from_hex(name_b)};
+            AssertThat(ids.count(object_id::from_hex(name_b)), Equals(1u));
+
+            std::stringstream out;
+            out << object_id::from_hex(name_b);
+            AssertThat(out.str(), Equals(name_b));
+        });
+    });
+}
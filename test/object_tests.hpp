@@ -1,10 +1,37 @@
 #ifndef OBJECT_TESTS_HPP_INCLUDED
 #define OBJECT_TESTS_HPP_INCLUDED
 
+#include "util/sha1dc.hpp"
+
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include <bandit/bandit.h>
 
+/// Name git gives to an object of this type and content, in hex.
+inline std::string object_hash(const std::string& type, const std::string& content) {
+    return git::hash_object(type, content.data(), content.size()).to_string();
+}
+
+/// True when callable throws an EXCEPTION.
+template <typename EXCEPTION, typename CALLABLE>
+bool throws(CALLABLE callable) {
+    try {
+        callable();
+    } catch (const EXCEPTION&) {
+        return true;
+    }
+    return false;
+}
+
+/// True when callable throws std::invalid_argument, for corrupt inputs.
+template <typename CALLABLE>
+bool throws_invalid_argument(CALLABLE callable) {
+    return throws<std::invalid_argument>(callable);
+}
+
 template <typename COLLECTED, typename CHECK, typename EXPECTED>
 void test_collected(std::string description, COLLECTED& items, const EXPECTED& expected_objects, CHECK check) {
     using namespace snowhouse;
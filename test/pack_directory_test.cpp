@@ -0,0 +1,296 @@
+#include "pack/directory.hpp"
+#include "pack/multi_index_writer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+#include "index_generator.hpp"
+#include "object_tests.hpp"
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+const static std::string MULTI_PACK_DIRECTORY(TEST_RESOURCE_PATH "/multi_pack");
+const static std::string MULTI_PACK_LARGE_DIRECTORY(TEST_RESOURCE_PATH "/multi_pack_large");
+
+namespace {
+
+struct expected_location {
+    std::string name;
+    std::string pack;
+    uint64_t offset;
+    std::string type;
+};
+
+const std::vector<expected_location>& get_expected_locations() {
+    static const std::string first = "pack-c3bf75e61604a4b8d099ca94fd5dc523108d2d23.idx";
+    static const std::string second = "pack-df9b8852f69f2eff3d0b0437560a739228a6ea3b.idx";
+    static const std::vector<expected_location> data {
+        { "552236f6f9961aa1ba61ad7e94f891ec5fac9147", first,   12, "commit" },
+        { "1fb3c9cc224016367c705ffd5869af4ac1752ebc", first,  455, "blob" },
+        { "190423f88f824548a6ada3207938ec0ec11455d5", first, 1032, "blob" },
+        { "be5a13bd491bb59971a573f86e453c63c2cb45b1", second,  12, "commit" },
+        { "c59c3ef7745d517d9a0f66390f756ebd47fbda69", second, 943, "tree" },
+        { "aa5e3f802c6a6d3eb7eac845d2293dec38ccfff1", second, 995, "blob" }
+    };
+    return data;
+}
+
+}
+
+void pack_directory_test() {
+    describe("multi-pack-index", [&]() {
+        multi_index_reader reader{fs::path(MULTI_PACK_DIRECTORY) / MULTI_PACK_INDEX_FILE_NAME};
+
+        it("reads the chunks", [&]() {
+            AssertThat(reader.size(), Equals(20u));
+            AssertThat(reader.get_pack_names().size(), Equals(2u));
+            AssertThat(reader.get_pack_names()[0], Equals("pack-c3bf75e61604a4b8d099ca94fd5dc523108d2d23.idx"));
+        });
+
+        it("finds objects", [&]() {
+            for (const auto& expected: get_expected_locations()) {
+                auto found = reader[object_id::from_hex(expected.name)];
+                AssertThat(reader.get_pack_names()[found.pack], Equals(expected.pack));
+                AssertThat(found.offset, Equals(expected.offset));
+            }
+            AssertThat(static_cast<bool>(reader[object_id{}]), Equals(false));
+        });
+
+        auto directory = fs::temp_directory_path() / "gitpp_midx_reader";
+        auto midx = directory / MULTI_PACK_INDEX_FILE_NAME;
+        auto first = object_id::from_hex("0a0b0c0d0e0f101112131415161718191a1b1c1d");
+        auto second = object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e");
+
+        before_each([&]() {
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+        });
+
+        it("reads offsets up to 4GiB without a large offset chunk", [&]() {
+            generator::write_multi_index(midx, { "pack-a.idx" }, { { first, 0, 0x80000000 }, { second, 0, 0xfffffff0 } });
+            multi_index_reader small{midx};
+            AssertThat(small[first].offset, Equals(0x80000000u));
+            AssertThat(small[second].offset, Equals(0xfffffff0u));
+        });
+
+        it("rejects chunks smaller than the fanout says", [&]() {
+            generator::write_multi_index(midx, { "pack-a.idx" }, { { first, 0, 12 }, { second, 0, 100 } }, 3);
+            AssertThat(throws_invalid_argument([&]() {
+                multi_index_reader reader{midx};
+            }), Equals(true));
+        });
+
+        it("rejects pack ids out of range", [&]() {
+            generator::write_multi_index(midx, { "pack-a.idx" }, { { first, 0, 12 }, { second, 1, 100 } });
+            multi_index_reader reader{midx};
+            AssertThat(reader[first].offset, Equals(12u));
+            AssertThat(throws_invalid_argument([&]() {
+                reader[second];
+            }), Equals(true));
+        });
+    });
+
+    describe("multi-pack-index writer", [&]() {
+        auto copy_packs = [](const fs::path& destination) {
+            fs::remove_all(destination);
+            fs::create_directories(destination);
+            for (const auto& entry: fs::directory_iterator(MULTI_PACK_DIRECTORY)) {
+                if (entry.path().filename() != MULTI_PACK_INDEX_FILE_NAME) {
+                    fs::copy(entry.path(), destination / entry.path().filename());
+                }
+            }
+        };
+
+        auto read_file = [](const fs::path& path) {
+            std::ifstream input(path, std::ios::binary);
+            return std::string{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+        };
+
+        it("writes the same file as git", [&]() {
+            auto directory = fs::temp_directory_path() / "gitpp_midx_writer";
+            copy_packs(directory);
+
+            write_multi_index(directory);
+            auto written = read_file(directory / MULTI_PACK_INDEX_FILE_NAME);
+            auto expected = read_file(fs::path(MULTI_PACK_DIRECTORY) / MULTI_PACK_INDEX_FILE_NAME);
+            AssertThat(written.size(), Equals(expected.size()));
+            AssertThat(written == expected, Equals(true));
+
+            fs::remove_all(directory);
+        });
+
+        it("fails while another writer holds the lock", [&]() {
+            auto directory = fs::temp_directory_path() / "gitpp_midx_locked";
+            copy_packs(directory);
+            auto lock = directory / (std::string(MULTI_PACK_INDEX_FILE_NAME) + ".lock");
+            std::ofstream(lock).put('\0');
+
+            bool failed = false;
+            try {
+                write_multi_index(directory);
+            } catch (const std::system_error&) {
+                failed = true;
+            }
+            AssertThat(failed, Equals(true));
+            AssertThat(fs::exists(lock), Equals(true));
+            AssertThat(fs::exists(directory / MULTI_PACK_INDEX_FILE_NAME), Equals(false));
+
+            fs::remove_all(directory);
+        });
+
+        it("writes offsets past 2GiB as git does", [&]() {
+            auto directory = fs::temp_directory_path() / "gitpp_midx_large";
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+            auto expected = [&](const std::string& name) {
+                return read_file(fs::path(MULTI_PACK_LARGE_DIRECTORY) / name);
+            };
+
+            // Up to 4GiB git writes offsets in place, the large offset chunk is left out.
+            generator::write_index(directory / "pack-a.idx", {
+                { object_id::from_hex("0a0b0c0d0e0f101112131415161718191a1b1c1d"), 12, 0 },
+                { object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e"), 0x90000000, 0 }
+            });
+            std::ofstream(directory / "pack-a.pack").put('\0');
+            write_multi_index(directory);
+            AssertThat(read_file(directory / MULTI_PACK_INDEX_FILE_NAME) == expected("below_4gib.midx"), Equals(true));
+
+            // Past 4GiB every offset with the top bit set goes to the large offset chunk.
+            generator::write_index(directory / "pack-b.idx", {
+                { object_id::from_hex("e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0e0"), 12, 0 },
+                { object_id::from_hex("c0ffee0000000000000000000000000000000000"), 0x100000000, 0 }
+            });
+            std::ofstream(directory / "pack-b.pack").put('\0');
+            write_multi_index(directory);
+            AssertThat(read_file(directory / MULTI_PACK_INDEX_FILE_NAME) == expected("above_4gib.midx"), Equals(true));
+
+            multi_index_reader reader{directory / MULTI_PACK_INDEX_FILE_NAME};
+            AssertThat(reader[object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e")].offset, Equals(0x90000000u));
+            AssertThat(reader[object_id::from_hex("c0ffee0000000000000000000000000000000000")].offset, Equals(0x100000000u));
+
+            fs::remove_all(directory);
+        });
+
+        it("takes duplicates from the preferred pack and writes large offsets", [&]() {
+            auto directory = fs::temp_directory_path() / "gitpp_midx_duplicates";
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+
+            auto shared = object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526e");
+            auto only_a = object_id::from_hex("0a0b0c0d0e0f101112131415161718191a1b1c1d");
+            generator::write_index(directory / "pack-a.idx", { { shared, 12, 0 }, { only_a, 0x100000000, 0 } });
+            generator::write_index(directory / "pack-b.idx", { { shared, 0x200000000, 0 } });
+            std::ofstream(directory / "pack-a.pack").put('\0');
+            std::ofstream(directory / "pack-b.pack").put('\0');
+
+            write_multi_index(directory, "pack-b.pack");
+            multi_index_reader preferred_b{directory / MULTI_PACK_INDEX_FILE_NAME};
+            AssertThat(preferred_b.size(), Equals(2u));
+            AssertThat(preferred_b[shared].pack, Equals(1u));
+            AssertThat(preferred_b[shared].offset, Equals(0x200000000u));
+            AssertThat(preferred_b[only_a].offset, Equals(0x100000000u));
+
+            write_multi_index(directory, "pack-a.idx");
+            multi_index_reader preferred_a{directory / MULTI_PACK_INDEX_FILE_NAME};
+            AssertThat(preferred_a[shared].pack, Equals(0u));
+            AssertThat(preferred_a[shared].offset, Equals(12u));
+
+            fs::remove_all(directory);
+        });
+    });
+
+    describe("pack directory", [&]() {
+        auto check_directory = [&](const pack_directory& packs) {
+            for (const auto& expected: get_expected_locations()) {
+                auto name = object_id::from_hex(expected.name);
+                auto found = packs.find(name);
+                AssertThat(packs.get_pack_path(found.pack).filename().string(), Equals(expected.pack));
+                AssertThat(found.offset, Equals(expected.offset));
+                AssertThat(packs.get_pack(found.pack).get_index()[found.position].get_name(), Equals(name));
+
+                auto object = packs[name];
+                AssertThat(object != nullptr, Equals(true));
+                AssertThat(object->get_name(), Equals(name));
+                AssertThat(object->get_pack_offset(), Equals(expected.offset));
+                AssertThat(object->get_type(), Equals(expected.type));
+            }
+            AssertThat(packs["0123456789012345678901234567890123456789"] == nullptr, Equals(true));
+        };
+
+        it("uses the multi-pack-index", [&]() {
+            pack_directory packs{MULTI_PACK_DIRECTORY};
+            AssertThat(packs.size(), Equals(2u));
+            AssertThat(packs.has_multi_index(), Equals(true));
+            check_directory(packs);
+        });
+
+        it("reads a batch pack by pack", [&]() {
+            pack_directory packs{MULTI_PACK_DIRECTORY};
+            std::vector<object_id> names{object_id{}};
+            const auto& expected = get_expected_locations();
+            for (auto it = expected.rbegin(); it != expected.rend(); ++it) {
+                names.push_back(object_id::from_hex(it->name));
+            }
+
+            std::vector<std::string> read;
+            auto count = packs.read_all(names,
+                [&](const object_id& name, const std::string& type, const std::vector<char>&) {
+                    auto found = std::find_if(expected.begin(), expected.end(), [&](const auto& location) {
+                        return location.name == name.to_string();
+                    });
+                    AssertThat(type, Equals(found->type));
+                    read.push_back(name.to_string());
+                });
+
+            // Expected locations are listed by pack, then by offset.
+            AssertThat(count, Equals(expected.size()));
+            for (std::size_t i = 0; i < expected.size(); i++) {
+                AssertThat(read[i], Equals(expected[i].name));
+            }
+        });
+
+        auto copy_packs = [](const fs::path& copy) {
+            fs::remove_all(copy);
+            fs::create_directories(copy);
+            for (const auto& entry: fs::directory_iterator(MULTI_PACK_DIRECTORY)) {
+                if (entry.path().filename() != MULTI_PACK_INDEX_FILE_NAME) {
+                    fs::copy(entry.path(), copy / entry.path().filename());
+                }
+            }
+        };
+
+        it("probes every pack without a multi-pack-index", [&]() {
+            auto copy = fs::temp_directory_path() / "gitpp_pack_directory";
+            copy_packs(copy);
+
+            {
+                pack_directory packs{copy};
+                AssertThat(packs.has_multi_index(), Equals(false));
+                check_directory(packs);
+            }
+            fs::remove_all(copy);
+        });
+
+        it("probes every pack when the multi-pack-index is corrupt", [&]() {
+            auto copy = fs::temp_directory_path() / "gitpp_pack_directory_corrupt";
+            copy_packs(copy);
+            std::ofstream(copy / MULTI_PACK_INDEX_FILE_NAME, std::ios::binary) << "MIDX truncated";
+
+            {
+                pack_directory packs{copy};
+                AssertThat(packs.has_multi_index(), Equals(false));
+                check_directory(packs);
+            }
+            fs::remove_all(copy);
+        });
+    });
+}
@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <iterator>
 
 #include <bandit/bandit.h>
 
@@ -14,6 +16,7 @@ using namespace bandit;
 using namespace snowhouse;
 
 const static std::string SAMPLE_INDEX_FILE(TEST_RESOURCE_PATH "/sample_pack.idx");
+const static std::string SAMPLE_REVERSE_INDEX_FILE(TEST_RESOURCE_PATH "/sample_pack.rev");
 
 void pack_index_test() {
     const static std::string INDEX_FILE(SAMPLE_INDEX_FILE);
@@ -23,7 +26,7 @@ void pack_index_test() {
         auto expected_items = data::get_expected_objects();
 
         auto verify_object = [&](const auto& obtained, const auto expected) {
-            AssertThat(obtained.get_name(), Equals(expected->name));
+            AssertThat(obtained.get_name().to_string(), Equals(expected->name));
             AssertThat(obtained.get_pack_offset(), Equals(expected->offset));
         };
 
@@ -39,6 +42,150 @@ void pack_index_test() {
             });
         }
 
+        it("unknown name is not found", [&]() {
+            auto item = index_file_container["0000000000000000000000000000000000000000"];
+            AssertThat(static_cast<bool>(item), Equals(false));
+            AssertThat(static_cast<bool>(index_file_container["ffffffffffffffffffffffffffffffffffffffff"]), Equals(false));
+        });
+
+        it("reports every candidate of an ambiguous prefix", [&]() {
+            auto range = index_file_container.find_prefix(object_id_prefix::from_hex("3"));
+            AssertThat(range.size(), Equals(2u));
+            AssertThat(range.is_ambiguous(), Equals(true));
+            AssertThat(index_file_container[range.first].get_name().to_string(), Equals(expected_items[0].name));
+            AssertThat(index_file_container[range.first + 1].get_name().to_string(), Equals(expected_items[1].name));
+            AssertThat(static_cast<bool>(index_file_container["3"]), Equals(false));
+        });
+
+        it("resolves one digit and odd length prefixes", [&]() {
+            AssertThat(index_file_container["4"].get_name().to_string(), Equals(expected_items[2].name));
+            AssertThat(index_file_container["f"].get_name().to_string(), Equals(expected_items.back().name));
+            AssertThat(index_file_container["7de"].get_name().to_string(), Equals(expected_items[5].name));
+            AssertThat(index_file_container.find_prefix(object_id_prefix::from_hex("7")).size(), Equals(2u));
+            AssertThat(index_file_container.find_prefix(object_id_prefix::from_hex("7e")).empty(), Equals(true));
+            AssertThat(index_file_container.find_prefix(object_id_prefix::from_hex("0")).empty(), Equals(true));
+            AssertThat(static_cast<bool>(index_file_container["xyz"]), Equals(false));
+        });
+
+        it("computes the shortest unique abbreviation", [&]() {
+            AssertThat(index_file_container.min_unique_abbreviation(1), Equals(2u));
+            AssertThat(index_file_container.min_unique_abbreviation(), Equals(4u));
+        });
+
+        it("finds many objects in one sweep", [&]() {
+            std::vector<object_id> names;
+            for (auto i: {11, 0, 13, 5, 5, 7}) {
+                names.push_back(object_id::from_hex(expected_items[i].name));
+            }
+            names.push_back(object_id::from_hex("0000000000000000000000000000000000000000"));
+            names.push_back(object_id::from_hex("3bb2a5be07fc75b1edfecd7ade1b29261850526f"));
+
+            auto found = index_file_container.find_all(names);
+            AssertThat(found.size(), Equals(names.size()));
+            for (size_t i = 0; i < 6; i++) {
+                AssertThat(found[i].input, Equals(i));
+                AssertThat(index_file_container[found[i].position].get_name(), Equals(names[i]));
+                AssertThat(found[i].offset, Equals(index_file_container[names[i]].get_pack_offset()));
+            }
+            AssertThat(static_cast<bool>(found[6]), Equals(false));
+            AssertThat(found[7].position, Equals(index_file_container.size()));
+
+            auto by_offset = index_file_container.find_all(names, lookup_order::pack_offset);
+            AssertThat(std::is_sorted(by_offset.begin(), by_offset.begin() + 6, [](const auto& a, const auto& b) {
+                return a.offset < b.offset;
+            }), Equals(true));
+            AssertThat(by_offset[0].offset, Equals(12u));
+            AssertThat(static_cast<bool>(by_offset[6]), Equals(false));
+            AssertThat(static_cast<bool>(by_offset[7]), Equals(false));
+        });
+
+        it("walks objects in pack order", [&]() {
+            std::vector<data::expected_objects> by_offset = expected_items;
+            std::sort(by_offset.begin(), by_offset.end(), [](const auto& a, const auto& b) {
+                return a.offset < b.offset;
+            });
+
+            auto item = index_file_container[by_offset.front().name];
+            for (const auto& expected: by_offset) {
+                AssertThat(item.get_name().to_string(), Equals(expected.name));
+                item = index_file_container.next(item);
+            }
+            AssertThat(static_cast<bool>(item), Equals(false));
+        });
+
+        it("maps the .rev file next to the index", [&]() {
+            AssertThat(index_file_container.get_reverse_index().is_mapped(), Equals(true));
+        });
+
+        it("writes the same reverse index as git", [&]() {
+            index_reader_base<file_source> computed{INDEX_FILE};
+            AssertThat(computed.get_reverse_index().is_mapped(), Equals(false));
+
+            auto path = fs::temp_directory_path() / "gitpp_sample_pack.rev";
+            computed.get_reverse_index().write(path, computed.get_pack_checksum());
+
+            std::ifstream written(path, std::ios::binary);
+            std::ifstream expected(SAMPLE_REVERSE_INDEX_FILE, std::ios::binary);
+            std::string written_data{std::istreambuf_iterator<char>(written), std::istreambuf_iterator<char>()};
+            std::string expected_data{std::istreambuf_iterator<char>(expected), std::istreambuf_iterator<char>()};
+            AssertThat(written_data == expected_data, Equals(true));
+
+            fs::remove(path);
+        });
+
+        it("rejects a .rev of another pack or with entries out of range", [&]() {
+            auto directory = fs::temp_directory_path() / "gitpp_reverse_index";
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+            auto index_path = directory / "sample_pack.idx";
+            auto reverse_path = directory / "sample_pack.rev";
+            fs::copy(INDEX_FILE, index_path);
+
+            std::ifstream input(SAMPLE_REVERSE_INDEX_FILE, std::ios::binary);
+            std::string original{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+            auto write_reverse = [&](std::size_t at) {
+                auto damaged = original;
+                damaged[at] ^= 0x40;
+                std::ofstream(reverse_path, std::ios::binary | std::ios::trunc).write(damaged.data(), damaged.size());
+            };
+
+            auto count = index_file_container.size();
+            auto checksum = index_file_container.get_pack_checksum();
+            auto rejected = [&]() {
+                return throws_invalid_argument([&]() {
+                    reverse_index::load(reverse_path, count, checksum);
+                });
+            };
+
+            // First byte of the pack checksum in the trailer, then of the first entry.
+            for (auto at: { original.size() - 40, std::size_t{12} }) {
+                write_reverse(at);
+                AssertThat(rejected(), Equals(true));
+
+                auto fallback = index_file_parser(index_path);
+                AssertThat(fallback.get_reverse_index().is_mapped(), Equals(false));
+                AssertThat(fallback.find_offset(expected_items[0].offset), Equals(fallback.find(object_id::from_hex(expected_items[0].name))));
+            }
+
+            fs::remove_all(directory);
+        });
+
+        it("rejects an index smaller than its tables", [&]() {
+            auto path = fs::temp_directory_path() / "gitpp_truncated_pack.idx";
+            std::ifstream input(INDEX_FILE, std::ios::binary);
+            std::string original{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+
+            // Within the fanout table, then one byte short of the names, crcs, offsets and trailer.
+            for (auto size: { std::size_t{100}, original.size() - 1 }) {
+                std::ofstream(path, std::ios::binary | std::ios::trunc).write(original.data(), size);
+                AssertThat(throws_invalid_argument([&]() {
+                    index_reader_base<file_source>{path.string()};
+                }), Equals(true));
+            }
+
+            fs::remove(path);
+        });
+
         test_collected("index loader", index_file_container, data::get_expected_objects(), verify_object);
     });
 }
@@ -2,8 +2,12 @@
 
 #include "object_tests.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <thread>
 
 #include <bandit/bandit.h>
 
@@ -15,12 +19,235 @@ using namespace snowhouse;
 
 const static std::string SAMPLE_PACK_FILE_BASE(TEST_RESOURCE_PATH "/sample_pack");
 
+namespace {
+
+/// Reads every object of the pack from many threads sharing loader, returns the number of bad reads.
+template <typename LOADER>
+unsigned read_from_threads(const LOADER& loader, unsigned thread_count, unsigned rounds) {
+    const auto& expected = data::get_expected_objects();
+    std::atomic<unsigned> failures{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            for (unsigned round = 0; round < rounds; round++) {
+                for (std::size_t i = 0; i < expected.size(); i++) {
+                    // Each thread starts somewhere else so the same objects get loaded concurrently.
+                    const auto& object = expected[(i + t) % expected.size()];
+                    try {
+                        auto& found = loader[object.name];
+                        auto content = found.read_content();
+                        auto stream = found.open_stream();
+                        std::string streamed{std::istreambuf_iterator<char>(*stream), std::istreambuf_iterator<char>()};
+                        if (object_hash(found.get_type(), std::string(content.begin(), content.end())) != object.name
+                                || object_hash(found.get_type(), streamed) != object.name) {
+                            failures++;
+                        }
+                    } catch (...) {
+                        failures++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    return failures;
+}
+
+}
+
 void pack_data_test() {
     describe("loading pack files test", [&]() {
         auto pack_file_container = pack_file_parser(SAMPLE_PACK_FILE_BASE);
+        it("finds many objects at once", [&]() {
+            const auto& expected = data::get_expected_objects();
+            std::vector<object_id> names{
+                object_id::from_hex(expected[9].name),
+                object_id{},
+                object_id::from_hex(expected[3].name)
+            };
+
+            auto found = pack_file_container.find_all(names);
+            AssertThat(found.size(), Equals(3u));
+            AssertThat(found[0]->get_name(), Equals(names[0]));
+            AssertThat(found[1] == nullptr, Equals(true));
+            AssertThat(found[2]->get_type(), Equals(expected[3].type));
+
+            auto by_offset = pack_file_container.find_all(names, lookup_order::pack_offset);
+            AssertThat(by_offset.size(), Equals(2u));
+            AssertThat(by_offset[0]->get_pack_offset(), Equals(expected[3].offset));
+            AssertThat(by_offset[1]->get_pack_offset(), Equals(expected[9].offset));
+        });
+
+        it("reads object records without descriptors", [&]() {
+            const auto& index = pack_file_container.get_index();
+            for (const auto& expected: data::get_expected_objects()) {
+                auto position = index.find(object_id::from_hex(expected.name));
+                auto record = pack_file_container.get_record(position);
+                AssertThat(record.size, Equals(expected.size));
+                AssertThat(record.is_delta(), Equals(expected.depth > 0));
+                if (record.is_delta()) {
+                    AssertThat(index[record.base].get_name().to_string(), Equals(expected.parent));
+                } else {
+                    AssertThat(pack_file_container.type_name(record.type), Equals(expected.type));
+                }
+            }
+        });
+
+        it("resolves delta chains only when asked", [&]() {
+            auto loader = pack_file_parser(SAMPLE_PACK_FILE_BASE);
+            const auto& index = loader.get_index();
+            for (const auto& expected: data::get_expected_objects()) {
+                if (expected.depth == 0) {
+                    continue;
+                }
+                auto position = index.find(object_id::from_hex(expected.name));
+                auto& delta = dynamic_cast<const pack_delta_descriptor&>(loader[position]);
+                AssertThat(loader.get_record(position).chain_resolved, Equals(false));
+
+                AssertThat(delta.get_pack_depth(), Equals(expected.depth));
+                auto record = loader.get_record(position);
+                AssertThat(record.chain_resolved, Equals(true));
+                AssertThat(unsigned{record.depth}, Equals(expected.depth));
+                AssertThat(loader.type_name(record.base_type), Equals(expected.type));
+            }
+        });
+
+        it("refuses to read objects that are not in the pack", [&]() {
+            auto& missing = pack_file_container[object_id{}];
+            AssertThat(static_cast<bool>(missing), Equals(false));
+            AssertThat(throws<std::out_of_range>([&]() { missing.read_content(); }), Equals(true));
+            AssertThat(throws<std::out_of_range>([&]() { missing.open_stream(); }), Equals(true));
+            AssertThat(throws<std::out_of_range>([&]() { missing.get_content(); }), Equals(true));
+
+            auto past_end = pack_file_container.size();
+            AssertThat(throws<std::out_of_range>([&]() { pack_file_container.read_stored(past_end); }), Equals(true));
+            AssertThat(throws<std::out_of_range>([&]() { pack_file_container.read_content(past_end); }), Equals(true));
+            AssertThat(throws<std::out_of_range>([&]() { object_arena{2}.get(2); }), Equals(true));
+        });
+
+        it("packs records in two words", [&]() {
+            object_arena arena{3};
+            object_record record;
+            record.size = 0x123456789abcdef;
+            record.base = 2;
+            record.type = 6;
+            record.header_size = 13;
+            arena.set(1, record);
+
+            AssertThat(bool(arena.get(0)), Equals(false));
+            auto stored = arena.get(1);
+            AssertThat(stored->size, Equals(record.size));
+            AssertThat(stored->base, Equals(2u));
+            AssertThat(unsigned{stored->type}, Equals(6u));
+            AssertThat(unsigned{stored->header_size}, Equals(13u));
+            AssertThat(object_arena::BYTES_PER_OBJECT, Equals(16u));
+        });
+
+        it("walks objects in pack order", [&]() {
+            auto check_walk = [&](auto&& range) {
+                std::vector<std::string> names;
+                uint64_t last_offset = 0;
+                for (const auto& object: range) {
+                    AssertThat(object.get_pack_offset() > last_offset, Equals(true));
+                    last_offset = object.get_pack_offset();
+                    names.push_back(object.get_name().to_string());
+                }
+                AssertThat(names.size(), Equals(range.size()));
+
+                std::vector<std::string> expected;
+                for (const auto& object: data::get_expected_objects()) {
+                    expected.push_back(object.name);
+                }
+                std::sort(names.begin(), names.end());
+                std::sort(expected.begin(), expected.end());
+                AssertThat(names, Equals(expected));
+            };
+
+            check_walk(pack_file_container.by_offset());
+            check_walk(pack_file_container.by_offset(4096, true));
+            check_walk(pack_file_parser(SAMPLE_PACK_FILE_BASE).by_offset(1));
+        });
+
+        it("walks entries that match the descriptors built on request", [&]() {
+            auto loader = pack_file_parser(SAMPLE_PACK_FILE_BASE);
+            for (const auto& entry: loader.by_offset()) {
+                const auto& descriptor = entry.get_descriptor();
+                AssertThat(entry.get_name(), Equals(descriptor.get_name()));
+                AssertThat(entry.get_type(), Equals(descriptor.get_type()));
+                AssertThat(entry.get_size(), Equals(descriptor.get_size()));
+                AssertThat(entry.get_pack_size(), Equals(descriptor.get_pack_size()));
+                AssertThat(entry.get_data_offset(), Equals(descriptor.get_data_offset()));
+                AssertThat(entry.get_data_size(), Equals(descriptor.get_data_size()));
+                AssertThat(entry.get_crc(), Equals(descriptor.get_crc()));
+
+                auto delta = dynamic_cast<const pack_delta_descriptor*>(&descriptor);
+                AssertThat(entry.is_delta(), Equals(delta != nullptr));
+                if (delta) {
+                    AssertThat(entry.get_pack_depth(), Equals(delta->get_pack_depth()));
+                    AssertThat(loader.get_index()[entry.get_delta_base()].get_name(), Equals(delta->get_delta_parent().get_name()));
+                }
+            }
+        });
+
+        it("plans reads in pack order with their delta bases", [&]() {
+            std::vector<object_id> names{
+                object_id::from_hex("decdd2877670620312624ce55de005f4517b4c5b"),
+                object_id::from_hex("78981922613b2afb6025042ff6bd878ac1994e85"),
+                object_id{},
+                object_id::from_hex("7dec0ebb72f5558c2f107f7833dbd90419c1710e"),
+                object_id::from_hex("decdd2877670620312624ce55de005f4517b4c5b")
+            };
+
+            auto plan = pack_file_container.plan_reads(names);
+            AssertThat(plan.objects.size(), Equals(3u));
+            AssertThat(plan.missing, Equals(1u));
+            const auto& index = pack_file_container.get_index();
+            AssertThat(index.offset_of(plan.objects[0]), Equals(12u));
+            AssertThat(index.offset_of(plan.objects[1]), Equals(757u));
+            AssertThat(index.offset_of(plan.objects[2]), Equals(912u));
+
+            // The chain of decdd28 goes through 712 and 537, all close enough to merge.
+            AssertThat(plan.ranges.size(), Equals(1u));
+            AssertThat(plan.ranges[0].begin, Equals(12u));
+            AssertThat(plan.ranges[0].end, Equals(923u));
+
+            std::vector<std::string> read;
+            auto count = pack_file_container.read_planned(plan,
+                [&](const object_id& name, const std::string& type, const std::vector<char>& content) {
+                    AssertThat(object_hash(type, std::string(content.begin(), content.end())), Equals(name.to_string()));
+                    read.push_back(name.to_string());
+                });
+            AssertThat(count, Equals(3u));
+            AssertThat(read, Equals(std::vector<std::string>{
+                "7dec0ebb72f5558c2f107f7833dbd90419c1710e",
+                "decdd2877670620312624ce55de005f4517b4c5b",
+                "78981922613b2afb6025042ff6bd878ac1994e85"
+            }));
+        });
+
+        it("plans nothing for an empty batch", [&]() {
+            auto plan = pack_file_container.plan_reads(std::vector<object_id>{});
+            AssertThat(plan.objects.size(), Equals(0u));
+            AssertThat(plan.ranges.size(), Equals(0u));
+            AssertThat(plan.missing, Equals(0u));
+        });
+
+        it("is shared by many threads", [&]() {
+            auto shared = pack_file_parser(SAMPLE_PACK_FILE_BASE);
+            AssertThat(read_from_threads(shared, 32, 20), Equals(0u));
+        });
+
+        it("is shared by many threads with a small delta base cache", [&]() {
+            auto shared = pack_file_parser(SAMPLE_PACK_FILE_BASE);
+            shared.set_delta_base_cache_limit(512);
+            AssertThat(read_from_threads(shared, 32, 20), Equals(0u));
+        });
+
         test_collected("pack loader", pack_file_container, data::get_expected_objects(),
             [&](auto& obtained, auto& expected) {
-                AssertThat(obtained.get_name(), Equals(expected->name));
+                AssertThat(obtained.get_name().to_string(), Equals(expected->name));
                 AssertThat(obtained.get_type(), Equals(expected->type));
                 AssertThat(obtained.get_size(), Equals(expected->size));
                 AssertThat(obtained.get_pack_offset(), Equals(expected->offset));
@@ -29,7 +256,7 @@ void pack_data_test() {
                     const auto& delta = dynamic_cast<const pack_delta_descriptor&>(obtained);
 
                     AssertThat(delta.get_pack_depth(), Equals(expected->depth));
-                    AssertThat(delta.get_delta_parent().get_name(), Equals(expected->parent));
+                    AssertThat(delta.get_delta_parent().get_name().to_string(), Equals(expected->parent));
                 }
             }
         );
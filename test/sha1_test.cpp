@@ -0,0 +1,49 @@
+#include "util/sha1.hpp"
+
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+#include "kernel_tests.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+void sha1_test() {
+    describe("sha1", [&]() {
+        auto digest = [](const std::string& input) {
+            return sha1{}.update(input).finish().to_string();
+        };
+
+        it("known vectors", [&]() {
+            AssertThat(digest(""), Equals("da39a3ee5e6b4b0d3255bfef95601890afd80709"));
+            AssertThat(digest("abc"), Equals("a9993e364706816aba3e25717850c26c9cd0d89d"));
+            AssertThat(digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                       Equals("84983e441c3bd26ebaae4aa1f95129e5e54670f1"));
+        });
+
+        it("incremental updates", [&]() {
+            std::string input(1000, 'a');
+            sha1 incremental;
+            for (std::size_t i = 0; i < input.size(); i += 7) {
+                incremental.update(input.data() + i, std::min<std::size_t>(7, input.size() - i));
+            }
+            AssertThat(incremental.finish().to_string(), Equals(digest(input)));
+            AssertThat(digest(input), Equals("291e9a6c66994949b57ba5e650361e98fc36b1ba"));
+        });
+
+        it("names git objects", [&]() {
+            AssertThat(digest(std::string("tree 0\0", 7)), Equals("4b825dc642cb6eb9a060e54bf8d69288fbee4904"));
+        });
+
+        it("hashes the same with and without hardware support", [&]() {
+            check_hardware_matches_portable<sha1>({ 0, 1, 55, 56, 63, 64, 65, 127, 128, 1000, 100000 }, 0, digest);
+
+            sha1::use_hardware(false);
+            AssertThat(digest("abc"), Equals("a9993e364706816aba3e25717850c26c9cd0d89d"));
+            sha1::use_hardware(true);
+        });
+    });
+}
@@ -0,0 +1,100 @@
+#include "util/sha1dc.hpp"
+
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace git;
+
+void sha1dc_test() {
+    describe("sha1dc", [&]() {
+        std::string input;
+        for (unsigned i = 0; i < 100000; i++) {
+            input.push_back(static_cast<char>(i * 7919 >> 3));
+        }
+
+        it("hashes like sha1", [&]() {
+            for (std::size_t size: { 0, 1, 55, 56, 63, 64, 65, 127, 128, 1000, 100000 }) {
+                sha1dc hash;
+                hash.update(input.data(), size);
+                AssertThat(hash.finish(), Equals(sha1{}.update(input.data(), size).finish()));
+                AssertThat(hash.collision_detected(), Equals(false));
+            }
+        });
+
+        it("builds the disturbance vectors git checks", [&]() {
+            const auto& vectors = sha1_collision::disturbance_vectors();
+            AssertThat(vectors.size(), Equals(32u));
+            for (const auto& vector: vectors) {
+                for (std::size_t step = 16; step < sha1_collision::STEPS; step++) {
+                    auto expanded = sha1_blocks::rotate(vector.dm[step - 3] ^ vector.dm[step - 8] ^ vector.dm[step - 14] ^ vector.dm[step - 16], 1);
+                    AssertThat(vector.dm[step], Equals(expanded));
+                }
+            }
+
+            // Message differences of I(43,0), II(45,0) and II(56,0) in SHA-1DC.
+            const auto& first = vectors.front();
+            AssertThat(first.test_step, Equals(58u));
+            AssertThat(first.dm[0], Equals(0x08000000u));
+            AssertThat(first.dm[1], Equals(0x9800000cu));
+            AssertThat(first.dm[58], Equals(0x00000001u));
+            AssertThat(first.dm[79], Equals(0x80000599u));
+
+            const auto& second_type = vectors[16];
+            AssertThat(second_type.type, Equals(2u));
+            AssertThat(second_type.dm[0], Equals(0xec000014u));
+            AssertThat(second_type.dm[79], Equals(0x00000967u));
+
+            const auto& last = vectors.back();
+            AssertThat(last.test_step, Equals(65u));
+            AssertThat(last.dm[0], Equals(0x2600001au));
+            AssertThat(last.dm[64], Equals(0x20000000u));
+            AssertThat(last.dm[79], Equals(0xc0000046u));
+
+        });
+
+        it("tests the vectors whose unavoidable conditions hold", [&]() {
+            for (const auto& condition: sha1_collision::unavoidable_conditions()) {
+                AssertThat(condition.vectors != 0, Equals(true));
+                AssertThat(condition.step < sha1_collision::STEPS && condition.other_step < sha1_collision::STEPS, Equals(true));
+                AssertThat(condition.bit < 32 && condition.other_bit < 32, Equals(true));
+            }
+
+            // The first condition of git's ubc_check, W[44] and W[45] have the same bit 29.
+            const auto& first = sha1_collision::unavoidable_conditions().front();
+            AssertThat(first.differ, Equals(false));
+            AssertThat(first.vectors, Equals(0x0283a080u));
+
+            uint32_t w[sha1_collision::STEPS] = {};
+            w[44] = 1u << 29;
+            AssertThat(sha1_collision::possible_vectors(w) & first.vectors, Equals(0u));
+        });
+
+        it("rebuilds the block from the state at the test step", [&]() {
+            // Without differences the other block is the block itself: it collides with itself
+            // only if going back and forth from the test step gives its chaining values again.
+            auto block = reinterpret_cast<const uint8_t*>(input.data());
+            for (unsigned k: { 49u, 56u }) {
+                auto vector = sha1_collision::make_disturbance_vector(2, k, 0);
+                vector.dm.fill(0);
+                std::vector<sha1_collision::disturbance_vector> vectors = { vector };
+
+                uint32_t expected[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+                uint32_t ihv[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+                for (std::size_t i = 0; i < 4; i++, block += sha1::BLOCK_SIZE) {
+                    sha1_blocks::portable(expected, block, 1);
+                    AssertThat(sha1_collision::compress(ihv, block, vectors), Equals(true));
+                    AssertThat(std::vector<uint32_t>(ihv, ihv + 5), Equals(std::vector<uint32_t>(expected, expected + 5)));
+                }
+            }
+        });
+
+        it("names git objects", [&]() {
+            AssertThat(hash_object("tree", "", 0).to_string(), Equals("4b825dc642cb6eb9a060e54bf8d69288fbee4904"));
+            AssertThat(hash_object("blob", "hello\n", 6).to_string(), Equals("ce013625030ba8dba906f756967f9e9ca394464a"));
+        });
+    });
+}
@@ -0,0 +1,59 @@
+#include "pack/loader.hpp"
+#include "pack/statistics.hpp"
+
+#include <numeric>
+
+#include <bandit/bandit.h>
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+void statistics_test() {
+    describe("pack statistics", [&]() {
+        auto loader = pack_file_parser(fs::path(TEST_RESOURCE_PATH) / "sample_pack");
+        auto stats = collect_pack_statistics(loader);
+
+        auto sum = [](const auto& values) {
+            return std::accumulate(values.begin(), values.end(), uint64_t{0});
+        };
+
+        it("counts objects by type", [&]() {
+            AssertThat(stats.object_count, Equals(14u));
+            AssertThat(stats.delta_count, Equals(4u));
+            AssertThat(stats.stored_count[1], Equals(4u));
+            AssertThat(stats.stored_count[6], Equals(4u));
+            AssertThat(stats.object_type_count[1], Equals(8u));
+            AssertThat(sum(stats.stored_count), Equals(14u));
+            AssertThat(sum(stats.object_type_count), Equals(14u));
+        });
+
+        it("adds up the packed sizes to the pack", [&]() {
+            AssertThat(sum(stats.packed_size), Equals(loader.get_pack_file_size() - 12 - OBJECT_NAME_SIZE));
+            AssertThat(stats.stored_size[3], Equals(2u + 5u));
+            AssertThat(stats.packed_size[3], Equals(11u + 14u));
+        });
+
+        it("counts delta chain lengths like git verify-pack", [&]() {
+            AssertThat(stats.chain_length_histogram.size(), Equals(3u));
+            AssertThat(stats.chain_length_histogram[0], Equals(10u));
+            AssertThat(stats.chain_length_histogram[1], Equals(3u));
+            AssertThat(stats.chain_length_histogram[2], Equals(1u));
+        });
+
+        it("counts deltas per base", [&]() {
+            AssertThat(sum(stats.fan_out_histogram), Equals(14u));
+            AssertThat(stats.fan_out_histogram[0], Equals(10u));
+            AssertThat(stats.fan_out_histogram[1], Equals(4u));
+            AssertThat(stats.widest_fan_out, Equals(1u));
+        });
+
+        it("buckets sizes by powers of two", [&]() {
+            AssertThat(pack_statistics::size_bucket(0), Equals(0u));
+            AssertThat(pack_statistics::size_bucket(1), Equals(1u));
+            AssertThat(pack_statistics::size_bucket(4095), Equals(12u));
+            AssertThat(pack_statistics::size_bucket(4096), Equals(13u));
+            AssertThat(sum(stats.size_histogram), Equals(14u));
+        });
+    });
+}
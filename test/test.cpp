@@ -41,14 +41,38 @@ void file_source_test();
 void big_unsigned_test();
 void pack_index_test();
 void pack_data_test();
+void large_pack_test();
+void pack_directory_test();
 void shared_container_test();
+void object_id_test();
+void sha1_test();
+void sha1dc_test();
+void crc32_test();
+void inflate_buffer_test();
+void delta_test();
+void object_header_test();
+void indexer_test();
+void verifier_test();
+void statistics_test();
 
 go_bandit([]{
     file_source_test();
     shared_container_test();
+    object_id_test();
+    sha1_test();
+    sha1dc_test();
+    crc32_test();
+    inflate_buffer_test();
     big_unsigned_test();
+    object_header_test();
     pack_index_test();
     pack_data_test();
+    delta_test();
+    large_pack_test();
+    pack_directory_test();
+    indexer_test();
+    verifier_test();
+    statistics_test();
 });
 
 int main(int argc, char* argv[]) {
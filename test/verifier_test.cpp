@@ -0,0 +1,114 @@
+#include "pack/indexer.hpp"
+#include "pack/loader.hpp"
+#include "pack/verifier.hpp"
+
+#include "index_generator.hpp"
+
+#include <fstream>
+#include <string>
+
+#include <bandit/bandit.h>
+
+using namespace git;
+using namespace bandit;
+using namespace snowhouse;
+
+namespace {
+
+/// Writes a pack of one blob with an index that names it, returns the pack base path.
+fs::path write_blob_pack(const fs::path& directory, const std::string& content, const object_id& name) {
+    auto object = generator::pack_object(3, content);
+    auto pack = generator::pack_contents({ object });
+    auto base = directory / "blob";
+    {
+        std::ofstream out(get_pack_path(base), std::ios::binary | std::ios::trunc);
+        out.write(pack.data(), pack.size());
+    }
+
+    auto checksum = object_id{reinterpret_cast<const uint8_t*>(pack.data() + pack.size() - OBJECT_NAME_SIZE)};
+    auto crc = crc32_checksum{}.update(object.data(), object.size()).value();
+    write_pack_index(get_index_path(base), { { name, 12, crc } }, checksum);
+    return base;
+}
+
+}
+
+void verifier_test() {
+    describe("pack verification", [&]() {
+        auto directory = fs::temp_directory_path() / "gitpp_verifier";
+        auto sample = fs::path(TEST_RESOURCE_PATH) / "sample_pack";
+
+        before_each([&]() {
+            fs::remove_all(directory);
+            fs::create_directories(directory);
+        });
+
+        it("accepts a sound pack", [&]() {
+            auto loader = pack_file_parser(sample);
+            auto result = verify_pack(loader, 2);
+            AssertThat(result.checksum_matches(), Equals(true));
+            AssertThat(result.corrupt_objects.size(), Equals(0u));
+            AssertThat(result.crc_mismatches.size(), Equals(0u));
+            AssertThat(result.ok(), Equals(true));
+            AssertThat(result.stored_checksum, Equals(compute_pack_checksum(loader)));
+        });
+
+        it("finds objects that do not hash to their name", [&]() {
+            auto wrong = object_id::from_hex("0123456789abcdef0123456789abcdef01234567");
+            auto loader = pack_file_parser(write_blob_pack(directory, "some content", wrong));
+            auto result = verify_pack(loader, 1);
+            AssertThat(result.checksum_matches(), Equals(true));
+            AssertThat(result.corrupt_objects.size(), Equals(1u));
+            AssertThat(result.corrupt_objects[0], Equals(wrong));
+            AssertThat(result.crc_mismatches.size(), Equals(0u));
+            AssertThat(result.ok(), Equals(false));
+        });
+
+        it("finds a pack that does not match its checksum", [&]() {
+            auto base = write_blob_pack(directory, "some content", generator::blob_name("some content"));
+            {
+                // The object count is not hashed by anything else, the object stays readable.
+                std::fstream pack(get_pack_path(base), std::ios::binary | std::ios::in | std::ios::out);
+                pack.seekp(8);
+                pack.put(1);
+            }
+            auto loader = pack_file_parser(base);
+            auto result = verify_pack(loader, 1);
+            AssertThat(result.computed_checksum, Is().Not().EqualTo(result.stored_checksum));
+            AssertThat(result.index_checksum, Equals(result.stored_checksum));
+            AssertThat(result.corrupt_objects.size(), Equals(0u));
+            AssertThat(result.ok(), Equals(false));
+        });
+
+        it("checks raw object bytes against the index CRCs", [&]() {
+            auto loader = pack_file_parser(sample);
+            AssertThat(find_crc_mismatches(loader, 1).size(), Equals(0u));
+            AssertThat(find_crc_mismatches(loader, 4).size(), Equals(0u));
+        });
+
+        it("finds damaged objects without inflating them", [&]() {
+            auto base = directory / "damaged";
+            fs::copy_file(get_pack_path(sample), get_pack_path(base));
+            fs::copy_file(get_index_path(sample), get_index_path(base));
+
+            auto index = index_file_parser(base);
+            auto damaged = index[0];
+            {
+                std::fstream pack(get_pack_path(base), std::ios::binary | std::ios::in | std::ios::out);
+                pack.seekg(damaged.get_pack_offset() + 4);
+                auto byte = static_cast<char>(pack.get() ^ 0x10);
+                pack.seekp(damaged.get_pack_offset() + 4);
+                pack.put(byte);
+            }
+
+            auto loader = pack_file_parser(base);
+            auto mismatches = find_crc_mismatches(loader, 2);
+            AssertThat(mismatches.size(), Equals(1u));
+            AssertThat(mismatches[0], Equals(damaged.get_name()));
+
+            auto result = verify_pack(loader, 2);
+            AssertThat(result.crc_mismatches.size(), Equals(1u));
+            AssertThat(result.ok(), Equals(false));
+        });
+    });
+}